@@ -0,0 +1,594 @@
+#include "Bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "GameWorld.h"
+#include "Renderer.h"
+#include "MultiplayerApi.h"
+#include "SnakeSync.h"
+#include "Highscore.h"
+
+static double now_us(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+}
+
+// --- render ---
+
+static Renderer bench_renderer;
+
+// Two bot snakes with some length to them, so frames look like a real match
+static void bench_world_reset(GameWorld *w, int width, int height, unsigned int seed) {
+    world_init(w, WORLD_SINGLEPLAYER, 2, seed);
+    world_set_arena(w, width, height);
+    world_reset(w);
+    for (int p = 0; p < w->player_count; p++)
+        body_grow(&w->players[p].body, MAX_LEN);
+}
+
+static void bench_world_step(GameWorld *w, int width, int height) {
+    WorldInput in;
+    world_bot_input(w, &in);
+    if (world_step(w, &in))
+        bench_world_reset(w, width, height, (unsigned int)w->tick + 1);
+}
+
+static void bench_render_size(int width, int height, int frames, int null_fd) {
+    GameWorld w;
+    Renderer *r = &bench_renderer;
+    const char *status = "P1: 0 | P2: 0";
+    double full_us = 0, diff_us = 0, write_us = 0;
+    size_t full_bytes = 0, diff_bytes = 0;
+
+    // Full repaint of every frame, as every frame used to be
+    bench_world_reset(&w, width, height, 1);
+    renderer_init(r, null_fd);
+    for (int i = 0; i < frames; i++) {
+        bench_world_step(&w, width, height);
+        renderer_invalidate(r);
+        double t0 = now_us();
+        renderer_compose(r, &w, 1, status);
+        full_us += now_us() - t0;
+        full_bytes += r->out_len;
+    }
+
+    // Only the changes since the previous frame
+    bench_world_reset(&w, width, height, 1);
+    renderer_init(r, null_fd);
+    for (int i = 0; i < frames; i++) {
+        bench_world_step(&w, width, height);
+        double t0 = now_us();
+        renderer_compose(r, &w, 1, status);
+        diff_us += now_us() - t0;
+        diff_bytes += r->out_len;
+    }
+
+    // Changes plus the single write() per frame
+    bench_world_reset(&w, width, height, 1);
+    renderer_init(r, null_fd);
+    for (int i = 0; i < frames; i++) {
+        bench_world_step(&w, width, height);
+        double t0 = now_us();
+        renderer_draw(r, &w, 1, status);
+        write_us += now_us() - t0;
+    }
+
+    printf("render %dx%d: full %.2f us/frame (%zu B), diff %.2f us/frame (%zu B), diff+write %.2f us/frame\n",
+           width, height,
+           full_us / frames, full_bytes / frames,
+           diff_us / frames, diff_bytes / frames,
+           write_us / frames);
+}
+
+static int bench_render(int argc, char **argv) {
+    int frames = argc > 0 ? atoi(argv[0]) : 2000;
+    if (frames < 1) frames = 1;
+
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd < 0) {
+        perror("/dev/null");
+        return 1;
+    }
+
+    bench_render_size(WIDTH, HEIGHT, frames, null_fd);
+    bench_render_size(MAX_WIDTH, MAX_HEIGHT, frames, null_fd);
+
+    close(null_fd);
+    return 0;
+}
+
+// --- dispatch ---
+
+// One event delivered straight to the listeners (mp_api_deliver) in a tight
+// loop, so only the listener walk and the calls are timed: no socket, no
+// parsing, no queue. The 0-listener run is the fixed cost per event.
+static void bench_count_listener(const char *event, int64_t messageId, const char *clientId,
+                                 json_t *data, void *user_data) {
+    (void)event; (void)messageId; (void)clientId; (void)data;
+    (*(long *)user_data)++;
+}
+
+// Returns nanoseconds per delivered event, or -1
+static double bench_dispatch_run(int listeners, int messages, long *calls) {
+    MultiplayerApi *api = mp_api_create("127.0.0.1", 0, "bench");
+    if (!api) return -1;
+    for (int i = 0; i < listeners; i++)
+        mp_api_listen(api, bench_count_listener, calls);
+
+    json_t *data = json_pack("{s:i}", "x", 12);
+    double t0 = now_us();
+    for (int i = 0; i < messages; i++)
+        mp_api_deliver(api, "game", i, "c2", data);
+    double elapsed = now_us() - t0;
+
+    json_decref(data);
+    mp_api_destroy(api);
+    return elapsed * 1e3 / messages;
+}
+
+static int bench_dispatch(int argc, char **argv) {
+    int messages = argc > 0 ? atoi(argv[0]) : 1000000;
+    if (messages < 1) messages = 1;
+
+    long calls = 0;
+    double base_ns = bench_dispatch_run(0, messages, &calls);
+    if (base_ns < 0) return 1;
+    printf("dispatch  0 listeners: %.1f ns/event (fixed cost)\n", base_ns);
+
+    const int counts[] = { 1, 8, 64 };
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        calls = 0;
+        double ns = bench_dispatch_run(counts[i], messages, &calls);
+        if (ns < 0 || calls != (long)counts[i] * messages) return 1;
+        printf("dispatch %2d listeners: %.1f ns/event, %.2f ns/listener call\n",
+               counts[i], ns, (ns - base_ns) / counts[i]);
+    }
+    return 0;
+}
+
+// --- sync ---
+
+static int same_body(const SnakeBody *a, const SnakeBody *b) {
+    if (a->length != b->length) return 0;
+    for (int s = 0; s < a->length; s++) {
+        const Segment *p = body_at_const(a, s), *q = body_at_const(b, s);
+        if (p->x != q->x || p->y != q->y) return 0;
+    }
+    return 1;
+}
+
+// Sends player 0 of a bot match on the largest arena through SnakeSync
+// every tick and checks that the receiving mirror matches the real snake
+// after each message. Each line is decoded twice, through a jansson tree
+// and with the streaming decoder, into two separate mirrors.
+static void bench_sync_run(const char *label, int ticks, int keyframes_only, int plain_body) {
+    GameWorld w;
+    SyncSender tx;
+    SyncReceiver rx_tree, rx_stream;
+    Segment body[MAX_LEN], foods[MAX_FOOD];
+    SyncMessage msg = { .body = body, .body_max = MAX_LEN, .foods = foods, .foods_max = MAX_FOOD };
+    double pack_us = 0, tree_us = 0, stream_us = 0;
+    size_t bytes = 0;
+    long mismatches = 0, fallbacks = 0, length_sum = 0;
+
+    bench_world_reset(&w, MAX_WIDTH, MAX_HEIGHT, 1);
+    for (int i = 0; i < MAX_LEN; i++)
+        bench_world_step(&w, MAX_WIDTH, MAX_HEIGHT); // grow to full length first
+    sync_sender_reset(&tx);
+    sync_receiver_reset(&rx_tree);
+    sync_receiver_reset(&rx_stream);
+    tx.plain_body = plain_body;
+
+    for (int i = 0; i < ticks; i++) {
+        bench_world_step(&w, MAX_WIDTH, MAX_HEIGHT);
+        const SnakeBody *b = &w.players[0].body;
+        if (keyframes_only) sync_request_keyframe(&tx);
+
+        char text[SYNC_TEXT_MAX];
+        double t0 = now_us();
+        int n = sync_write(&tx, b, NULL, text, sizeof(text));
+        pack_us += now_us() - t0;
+        bytes += n;
+        length_sum += b->length;
+
+        // What the server relays: the data inside the game envelope
+        char line[SYNC_TEXT_MAX + 128];
+        int len = snprintf(line, sizeof(line),
+                           "{\"cmd\":\"game\",\"messageId\":%d,\"clientId\":\"bench\",\"data\":%.*s}",
+                           i, n, text);
+
+        t0 = now_us();
+        json_t *root = json_loadb(line, (size_t)len, 0, NULL);
+        sync_message_from_json(json_string_value(json_object_get(root, "clientId")), json_object_get(root, "data"), &msg);
+        sync_apply(&rx_tree, &msg);
+        tree_us += now_us() - t0;
+        json_decref(root);
+
+        t0 = now_us();
+        if (sync_decode_line(line, (size_t)len, &msg)) sync_apply(&rx_stream, &msg);
+        else fallbacks++;
+        stream_us += now_us() - t0;
+
+        if (!same_body(&rx_tree.body, b) || !same_body(&rx_stream.body, b)) mismatches++;
+    }
+
+    printf("sync %-9s: %6.1f B/tick, pack %.2f us, unpack tree %.2f us, streaming %.2f us, "
+           "avg length %ld, %ld keyframes, %ld fallbacks, %ld mismatches\n",
+           label, (double)bytes / ticks, pack_us / ticks, tree_us / ticks, stream_us / ticks,
+           length_sum / ticks, tx.keyframes, fallbacks, mismatches);
+}
+
+// Two senders whose lines arrive interleaved, as in a room with more than
+// one peer. The receiver must mirror the first one and leave the other's
+// "q" counter alone, so neither gaps nor resync requests may appear.
+static int bench_sync_peers(int ticks) {
+    GameWorld a, b;
+    SyncSender tx_a, tx_b;
+    SyncReceiver rx;
+    Segment body[MAX_LEN], foods[MAX_FOOD];
+    SyncMessage msg = { .body = body, .body_max = MAX_LEN, .foods = foods, .foods_max = MAX_FOOD };
+    long mismatches = 0, resyncs = 0;
+
+    bench_world_reset(&a, MAX_WIDTH, MAX_HEIGHT, 1);
+    bench_world_reset(&b, MAX_WIDTH, MAX_HEIGHT, 2);
+    sync_sender_reset(&tx_a);
+    sync_sender_reset(&tx_b);
+    sync_receiver_reset(&rx);
+
+    for (int i = 0; i < ticks; i++) {
+        GameWorld *w = (i & 1) ? &b : &a;
+        SyncSender *tx = (i & 1) ? &tx_b : &tx_a;
+        bench_world_step(w, MAX_WIDTH, MAX_HEIGHT);
+
+        char text[SYNC_TEXT_MAX];
+        int n = sync_write(tx, &w->players[0].body, NULL, text, sizeof(text));
+        char line[SYNC_TEXT_MAX + 128];
+        int len = snprintf(line, sizeof(line),
+                           "{\"cmd\":\"game\",\"messageId\":%d,\"clientId\":\"%s\",\"data\":%.*s}",
+                           i, (i & 1) ? "B" : "A", n, text);
+
+        if (!sync_decode_line(line, (size_t)len, &msg)) {
+            mismatches++;
+            continue;
+        }
+        if (sync_apply(&rx, &msg) == SYNC_RESYNC) resyncs++;
+        if (!same_body(&rx.body, &a.players[0].body)) mismatches++;
+    }
+
+    printf("sync 2 senders: mirrors %s, %ld ignored from the other, %ld resync requests, %ld mismatches\n",
+           rx.peer, rx.foreign, resyncs, mismatches);
+    return mismatches == 0 && resyncs == 0 ? 0 : 1;
+}
+
+static int bench_sync(int argc, char **argv) {
+    int ticks = argc > 0 ? atoi(argv[0]) : 5000;
+    if (ticks < 1) ticks = 1;
+
+    bench_sync_run("full body", ticks, 1, 1);
+    bench_sync_run("packed", ticks, 1, 0);
+    bench_sync_run("delta", ticks, 0, 0);
+    return bench_sync_peers(ticks);
+}
+
+// --- send queue ---
+
+static void bench_send_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n <= 0) return;
+        buf += n;
+        len -= (size_t)n;
+    }
+}
+
+// Listening loopback socket on a free port; returns the port, or -1
+static int bench_listen(int *listen_fd) {
+    int lfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (lfd < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(lfd, 1) < 0 ||
+        getsockname(lfd, (struct sockaddr *)&addr, &addr_len) < 0) {
+        close(lfd);
+        return -1;
+    }
+    *listen_fd = lfd;
+    return ntohs(addr.sin_port);
+}
+
+// A stalled peer and a full send queue whose newest lines are a delta and a
+// resync request. MP_API_SEND_COALESCE must not overwrite either: a
+// keyframe and another delta sent now have to be turned away with
+// MP_API_ERR_FULL, and the queued two must reach the peer, in order, once
+// it reads again. The filler lines only exist to fill the socket buffers.
+#define BENCH_FILLER (256 * 1024)
+#define BENCH_SMALL_LINES 8
+
+typedef struct {
+    int listen_fd;
+    atomic_int reading;  // the peer stays silent until this is set
+    char small[BENCH_SMALL_LINES][128]; // lines other than the fillers
+    int small_count;
+} BenchPeer;
+
+static void *bench_peer_thread(void *arg) {
+    BenchPeer *p = (BenchPeer *)arg;
+    int fd = accept(p->listen_fd, NULL, NULL);
+    if (fd < 0) return NULL;
+
+    char c;
+    while (recv(fd, &c, 1, 0) == 1 && c != '\n')
+        ;
+    const char *reply = "{\"cmd\":\"host\",\"session\":\"BENCH\",\"clientId\":\"c1\"}\n";
+    bench_send_all(fd, reply, strlen(reply));
+
+    while (!atomic_load(&p->reading))
+        usleep(1000);
+
+    char buf[65536], line[128];
+    size_t len = 0;
+    int too_long = 0;
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] == '\n') {
+                if (!too_long && p->small_count < BENCH_SMALL_LINES) {
+                    memcpy(p->small[p->small_count], line, len);
+                    p->small[p->small_count++][len] = '\0';
+                }
+                len = 0;
+                too_long = 0;
+            } else if (len < sizeof(line) - 1) {
+                line[len++] = buf[i];
+            } else {
+                too_long = 1;
+            }
+        }
+    }
+    close(fd);
+    return NULL;
+}
+
+static int bench_sendq(void) {
+    BenchPeer peer;
+    memset(&peer, 0, sizeof(peer));
+    int port = bench_listen(&peer.listen_fd);
+    pthread_t th;
+    if (port < 0 || pthread_create(&th, NULL, bench_peer_thread, &peer) != 0) {
+        fprintf(stderr, "sendq: loopback setup failed\n");
+        return 1;
+    }
+
+    static char filler[BENCH_FILLER];
+    int filler_len = snprintf(filler, sizeof(filler), "{\"pad\":\"");
+    memset(filler + filler_len, 'x', sizeof(filler) - filler_len - 3);
+    memcpy(filler + sizeof(filler) - 3, "\"}", 3);
+    filler_len = (int)sizeof(filler) - 1;
+
+    const char delta[] = "{\"q\":7,\"hx\":3,\"hy\":4,\"g\":0}";
+    const char resync[] = "{\"resync\":true}";
+    const char keyframe[] = "{\"q\":8,\"hx\":3,\"hy\":5,\"n\":2,\"bd\":\"A\"}";
+    int rc_delta = -1, rc_resync = -1, rc_keyframe = -1, rc_late_delta = -1;
+    MpApiSendStats st;
+    memset(&st, 0, sizeof(st));
+
+    MultiplayerApi *api = mp_api_create("127.0.0.1", port, "bench");
+    if (api && mp_api_set_send_queue(api, 3, MP_API_SEND_COALESCE) == MP_API_OK &&
+        mp_api_host(api, NULL, NULL, NULL) == MP_API_OK) {
+        // Once a filler stays queued the sender thread is stuck in send()
+        int stuck = 0;
+        for (int i = 0; i < 1000 && !stuck; i++) {
+            if (mp_api_game_text(api, filler, (size_t)filler_len) != MP_API_OK) break;
+            usleep(20000);
+            mp_api_send_stats(api, &st);
+            stuck = st.queued == 1;
+        }
+
+        if (stuck) {
+            rc_delta = mp_api_game_text(api, delta, sizeof(delta) - 1);
+            rc_resync = mp_api_game_text(api, resync, sizeof(resync) - 1);
+            rc_keyframe = mp_api_game_state_text(api, keyframe, sizeof(keyframe) - 1);
+            rc_late_delta = mp_api_game_text(api, delta, sizeof(delta) - 1);
+            mp_api_send_stats(api, &st);
+
+            // The queued lines plus the one stuck in send() must all go out
+            long expect = st.messages + st.queued + 1;
+            atomic_store(&peer.reading, 1);
+            MpApiSendStats now;
+            for (int i = 0; i < 5000; i++) {
+                mp_api_send_stats(api, &now);
+                if (now.messages >= expect) break;
+                usleep(1000);
+            }
+        }
+    }
+    atomic_store(&peer.reading, 1);
+    mp_api_destroy(api); // closes the socket, so the peer sees the end
+    pthread_join(th, NULL);
+    close(peer.listen_fd);
+
+    int ok = rc_delta == MP_API_OK && rc_resync == MP_API_OK &&
+             rc_keyframe == MP_API_ERR_FULL && rc_late_delta == MP_API_ERR_FULL &&
+             st.coalesced == 0 && st.rejected == 2 && peer.small_count == 2 &&
+             strstr(peer.small[0], "\"g\":0") && strstr(peer.small[1], "\"resync\"");
+    printf("sendq full of delta + resync: keyframe rc %d, delta rc %d, %ld coalesced, %ld turned away, "
+           "%d of 2 queued lines arrived in order: %s\n",
+           rc_keyframe, rc_late_delta, st.coalesced, st.rejected, peer.small_count, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+// --- highscore ---
+
+// Readers copy the board while a submitter keeps raising every player's
+// score. Player i only ever scores round * BENCH_HS_PLAYERS + i, so an
+// entry whose score does not belong to its name, a repeated name or a
+// board out of order means a reader got a half-written copy.
+#define BENCH_HS_PLAYERS 64
+#define BENCH_HS_READERS 3
+
+typedef struct {
+    HighscoreStore *hs;
+    atomic_int done;
+    long reads;
+    long torn;
+} BenchBoard;
+
+static int board_consistent(const LeaderboardEntry *e, int n) {
+    char seen[BENCH_HS_PLAYERS] = {0};
+    if (n > BENCH_HS_PLAYERS) return 0;
+    for (int i = 0; i < n; i++) {
+        int player;
+        if (sscanf(e[i].name, "p%d", &player) != 1 || player < 0 || player >= BENCH_HS_PLAYERS) return 0;
+        if (seen[player]++) return 0;
+        if (e[i].score % BENCH_HS_PLAYERS != player) return 0;
+        if (i > 0 && e[i].score > e[i - 1].score) return 0;
+    }
+    return 1;
+}
+
+static void *bench_board_reader(void *arg) {
+    BenchBoard *b = (BenchBoard *)arg;
+    LeaderboardEntry top[LEADERBOARD_TOP];
+    while (!atomic_load(&b->done)) {
+        int n = highscore_top(b->hs, 0, top, LEADERBOARD_TOP);
+        if (!board_consistent(top, n)) b->torn++;
+        b->reads++;
+    }
+    return NULL;
+}
+
+// Several game processes saving to one leaderboard file at once, as host
+// and guest started from the same directory would. Every process submits
+// names nobody else uses, so the file must end up with all of them.
+#define BENCH_HS_PROCS 4
+#define BENCH_HS_PROC_SCORES 100
+
+static int bench_highscore_procs(void) {
+    char path[] = "/tmp/snake-bench-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "highscore: no temporary file\n");
+        return 1;
+    }
+    close(fd);
+
+    for (int p = 0; p < BENCH_HS_PROCS; p++) {
+        if (fork() != 0) continue;
+        HighscoreStore *hs = highscore_store_create(path);
+        for (int i = 0; hs && i < BENCH_HS_PROC_SCORES; i++) {
+            char name[16];
+            snprintf(name, sizeof(name), "p%d_%d", p, i);
+            while (!highscore_submit(hs, 0, name, 1000 + i)) usleep(100); // queue full
+            usleep(200);
+        }
+        highscore_store_destroy(hs);
+        _exit(0);
+    }
+    while (wait(NULL) > 0)
+        ;
+
+    static LeaderboardEntry top[LEADERBOARD_TOP];
+    HighscoreStore *hs = highscore_store_create(path);
+    int kept = hs ? highscore_top(hs, 0, top, LEADERBOARD_TOP) : 0;
+    highscore_store_destroy(hs);
+    unlink(path);
+
+    int ok = kept == BENCH_HS_PROCS * BENCH_HS_PROC_SCORES;
+    printf("highscore %d processes sharing one file: %d of %d scores kept: %s\n",
+           BENCH_HS_PROCS, kept, BENCH_HS_PROCS * BENCH_HS_PROC_SCORES, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static int bench_highscore(int argc, char **argv) {
+    int rounds = argc > 0 ? atoi(argv[0]) : 2000;
+    if (rounds < 1) rounds = 1;
+
+    BenchBoard boards[BENCH_HS_READERS];
+    pthread_t readers[BENCH_HS_READERS];
+    HighscoreStore *hs = highscore_store_create(NULL);
+    if (!hs) {
+        fprintf(stderr, "highscore: store setup failed\n");
+        return 1;
+    }
+
+    int started = 0;
+    for (; started < BENCH_HS_READERS; started++) {
+        BenchBoard *b = &boards[started];
+        memset(b, 0, sizeof(*b));
+        b->hs = hs;
+        if (pthread_create(&readers[started], NULL, bench_board_reader, b) != 0) break;
+    }
+
+    double t0 = now_us();
+    long lost = 0;
+    for (int r = 1; r <= rounds; r++) {
+        for (int i = 0; i < BENCH_HS_PLAYERS; i++) {
+            char name[16];
+            snprintf(name, sizeof(name), "p%d", i);
+            int score = r * BENCH_HS_PLAYERS + i;
+            // 0 while the pending queue is full; the writer will catch up
+            int tries = 0;
+            while (!highscore_submit(hs, 0, name, score) && highscore_best(hs, 0, name) < score) {
+                if (++tries > 100000) {
+                    lost++;
+                    break;
+                }
+                sched_yield();
+            }
+        }
+    }
+    double elapsed = now_us() - t0;
+
+    long reads = 0, torn = 0;
+    for (int i = 0; i < started; i++) {
+        atomic_store(&boards[i].done, 1);
+        pthread_join(readers[i], NULL);
+        reads += boards[i].reads;
+        torn += boards[i].torn;
+    }
+    highscore_store_destroy(hs);
+
+    int ok = started == BENCH_HS_READERS && torn == 0 && lost == 0;
+    printf("highscore %d submits under %d readers: %.0f board reads/s, %ld torn, %ld lost: %s\n",
+           rounds * BENCH_HS_PLAYERS, started, reads / (elapsed / 1e6), torn, lost, ok ? "ok" : "FAILED");
+
+    int procs_failed = bench_highscore_procs();
+    return ok && !procs_failed ? 0 : 1;
+}
+
+// --- entry ---
+
+int main_bench(int argc, char **argv) {
+    const char *name = argc > 0 ? argv[0] : "";
+
+    if (strcmp(name, "render") == 0) return bench_render(argc - 1, argv + 1);
+    if (strcmp(name, "dispatch") == 0) return bench_dispatch(argc - 1, argv + 1);
+    if (strcmp(name, "sync") == 0) return bench_sync(argc - 1, argv + 1);
+    if (strcmp(name, "sendq") == 0) return bench_sendq();
+    if (strcmp(name, "highscore") == 0) return bench_highscore(argc - 1, argv + 1);
+
+    fprintf(stderr, "usage: Snake --bench render [frames]\n"
+                    "       Snake --bench dispatch [messages]\n"
+                    "       Snake --bench sync [ticks]\n"
+                    "       Snake --bench sendq\n"
+                    "       Snake --bench highscore [rounds]\n");
+    return 1;
+}
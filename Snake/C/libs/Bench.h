@@ -0,0 +1,9 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Offline micro-benchmarks, run as ./Snake --bench <name> [args]. They live
+// in the game binary so they measure exactly the code the game runs.
+
+int main_bench(int argc, char **argv);
+
+#endif //BENCH_H
@@ -0,0 +1,105 @@
+#include "EventLoop.h"
+
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+typedef struct {
+    int fd; // -1 when the slot is free
+    EventHandler cb;
+    void *user_data;
+} EventSlot;
+
+struct EventLoop {
+    int epfd;
+    EventSlot slots[EVENT_LOOP_MAX_FDS];
+};
+
+EventLoop *event_loop_create(void) {
+    EventLoop *loop = (EventLoop *)calloc(1, sizeof(EventLoop));
+    if (!loop) return NULL;
+
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epfd < 0) {
+        free(loop);
+        return NULL;
+    }
+
+    for (int i = 0; i < EVENT_LOOP_MAX_FDS; i++)
+        loop->slots[i].fd = -1;
+    return loop;
+}
+
+void event_loop_destroy(EventLoop *loop) {
+    if (!loop) return;
+    close(loop->epfd);
+    free(loop);
+}
+
+static EventSlot *find_slot(EventLoop *loop, int fd) {
+    for (int i = 0; i < EVENT_LOOP_MAX_FDS; i++) {
+        if (loop->slots[i].fd == fd) return &loop->slots[i];
+    }
+    return NULL;
+}
+
+int event_loop_add(EventLoop *loop, int fd, unsigned int events, EventHandler cb, void *user_data) {
+    if (!loop || fd < 0 || !cb) return -1;
+
+    EventSlot *slot = find_slot(loop, -1);
+    if (!slot) return -1;
+
+    struct epoll_event ev = {0};
+    ev.events = events;
+    ev.data.ptr = slot;
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) return -1;
+
+    slot->fd = fd;
+    slot->cb = cb;
+    slot->user_data = user_data;
+    return 0;
+}
+
+int event_loop_modify(EventLoop *loop, int fd, unsigned int events) {
+    if (!loop || fd < 0) return -1;
+
+    EventSlot *slot = find_slot(loop, fd);
+    if (!slot) return -1;
+
+    struct epoll_event ev = {0};
+    ev.events = events;
+    ev.data.ptr = slot;
+    return epoll_ctl(loop->epfd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void event_loop_remove(EventLoop *loop, int fd) {
+    if (!loop || fd < 0) return;
+
+    EventSlot *slot = find_slot(loop, fd);
+    if (!slot) return;
+
+    epoll_ctl(loop->epfd, EPOLL_CTL_DEL, fd, NULL);
+    slot->fd = -1;
+    slot->cb = NULL;
+}
+
+int event_loop_run_once(EventLoop *loop, int timeout_ms) {
+    if (!loop) return -1;
+
+    struct epoll_event events[EVENT_LOOP_MAX_FDS];
+    int n = epoll_wait(loop->epfd, events, EVENT_LOOP_MAX_FDS, timeout_ms);
+    if (n < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    int ran = 0;
+    for (int i = 0; i < n; i++) {
+        EventSlot *slot = (EventSlot *)events[i].data.ptr;
+        // A handler earlier in this batch may have removed this fd
+        if (slot->fd < 0 || !slot->cb) continue;
+        slot->cb(slot->fd, events[i].events, slot->user_data);
+        ran++;
+    }
+    return ran;
+}
@@ -0,0 +1,27 @@
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+// Small epoll wrapper: the main loop blocks on every fd it cares about at
+// once (stdin, the tick timerfd, sockets) and sleeps at 0% CPU until one of
+// them is ready.
+
+#define EVENT_LOOP_MAX_FDS 16
+
+typedef void (*EventHandler)(int fd, unsigned int events, void *user_data);
+
+typedef struct EventLoop EventLoop;
+
+/* Returns NULL on error. */
+EventLoop *event_loop_create(void);
+void event_loop_destroy(EventLoop *loop);
+
+/* events is an EPOLLIN/EPOLLOUT mask. Returns 0 on success, -1 on error. */
+int event_loop_add(EventLoop *loop, int fd, unsigned int events, EventHandler cb, void *user_data);
+int event_loop_modify(EventLoop *loop, int fd, unsigned int events);
+void event_loop_remove(EventLoop *loop, int fd);
+
+/* Waits up to timeout_ms (-1 = forever) and runs the handlers of every ready
+   fd. Returns the number of handlers run, or -1 on error. */
+int event_loop_run_once(EventLoop *loop, int timeout_ms);
+
+#endif //EVENTLOOP_H
@@ -3,37 +3,21 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdlib.h>
+#include <string.h>
 // NOTE: You must also include the headers for MultiplayerApi and jansson if needed for runSinglePlayerGameTick
 
 // ---------------------------------------------------------
 // --- 1. Global Variable Definitions (WITHOUT 'extern') ---
 // ---------------------------------------------------------
-int foodX_array[MAX_FOOD];
-int foodY_array[MAX_FOOD];
-int active_food_count = 0;
-
 int is_host = 0;
 int active_players = 1;
+int connection_lost = 0;
 
 GameState current_state = STATE_MENU; 
-Segment snake[MAX_LEN];
-int snake_length = 3;
-int dirX = 1;
-int dirY = 0;
-int foodX;
-int foodY;
-Segment snake2[MAX_LEN];
-int snake2_length = 3;
-int dirX2 = -1; // Starts moving left
-int dirY2 = 0;
 
 char retry;
 struct termios orig;
 
-int royale_tick_counter = 0;
-int currentWidth = WIDTH;   // Default 40
-int currentHeight = HEIGHT; // Default 20
-
 // ----------------------------------------
 // --- 2. Terminal Handling Definitions ---
 // ----------------------------------------
@@ -52,6 +36,9 @@ void enableRawMode()  {
 
 void disableRawMode() {
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &orig);
+
+    // Blocking again, so line input like the join code can wait for the user
+    fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) & ~O_NONBLOCK);
     printf("\033[?25l");
 }
 
@@ -59,181 +46,178 @@ void disableRawMode() {
 // --- 3. Game Logic Definitions ---
 // ---------------------------------
 
-void spawnFood() {
-    // Use currentWidth/Height instead of static WIDTH/HEIGHT
-    foodX = rand() % currentWidth;
-    foodY = rand() % currentHeight;
+// Turns typed by each local player, taken one per tick (P1 WASD, P2 IJKL)
+static TurnQueue turn_queue[2];
 
-    // IMPORTANT: Sync the array that draw() actually looks at
-    foodX_array[0] = foodX;
-    foodY_array[0] = foodY;
-    active_food_count = 1; 
+// Queued turns belong to the match they were typed in
+static void reset_turn_queues(const GameWorld* w) {
+    for (int p = 0; p < 2; p++) {
+        turn_queue_reset(&turn_queue[p], (Turn){ w->players[p].dirX, w->players[p].dirY });
+    }
 }
 
-void spawnRoyaleFood() {
-    // 10 players = 5 food; 5 players = 2 food
-    int amount_to_spawn = active_players / 2;
-    if (amount_to_spawn < 1) amount_to_spawn = 1;
-
-    // Use a loop to spawn into food array
-    for (int i = 0; i < amount_to_spawn; i++) {
-        foodX_array[i] = rand() % currentWidth;
-        foodY_array[i] = rand() % currentHeight;
+static WorldMode world_mode_for(GameState state) {
+    switch (state) {
+        case STATE_MULTIPLAYER_LOCAL:  return WORLD_LOCAL_1V1;
+        case STATE_MULTIPLAYER_ONLINE: return WORLD_ONLINE;
+        case STATE_STARVATION_ROYALE:
+        case STATE_ROYALE_SPECTATOR:   return WORLD_ROYALE;
+        default:                       return WORLD_SINGLEPLAYER;
     }
 }
 
-// Flytta ormen
-void moveSnake() {
-    // flytta kroppen
-    for (int i = snake_length - 1; i > 0; i--) {
-        snake[i] = snake[i - 1];
-    }
+// Starts a fresh match for the current state
+void game_restart(GameWorld* w) {
+    WorldMode mode = world_mode_for(current_state);
+    int players = (mode == WORLD_SINGLEPLAYER) ? 1 : 2;
 
-    // nytt huvud
-    snake[0].x += dirX;
-    snake[0].y += dirY;
-}
+    world_init(w, mode, players, (unsigned int)rand());
 
-void game_restart() {
-    // Reset snake state
-    snake_length = 3;
-    dirX = 1;
-    dirY = 0;
-    
-    // Reset snake position
-    snake[0] = (Segment){ WIDTH / 2, HEIGHT / 2 };
-    snake[1] = (Segment){ WIDTH / 2 - 1, HEIGHT / 2 };
-    snake[2] = (Segment){ WIDTH / 2 - 2, HEIGHT / 2 };
-
-    // Reset snake2 state
-    snake2_length = 3;
-    dirX2 = -1; 
-    dirY2 = 0;
-
-    //Reset snake2 position
-    snake2[0] = (Segment){ WIDTH - 6, HEIGHT / 2 };
-    snake2[1] = (Segment){ WIDTH - 5, HEIGHT / 2 };
-    snake2[2] = (Segment){ WIDTH - 4, HEIGHT / 2 };
-    
-    // Spawn new food
-    spawnFood();
+    // Only the host (or an offline game) decides where food goes
+    if (mode == WORLD_ONLINE) w->owns_food = is_host;
+
+    // Royale runs our own snake plus the last opponent we heard from
+    if (mode == WORLD_ROYALE) w->players[1].remote = 1;
+
+    reset_turn_queues(w);
+    invalidateScreen();
 }
 
-// Returnerar 1 om kollision inträffat
-int checkCollision() {
-    int x = snake[0].x;
-    int y = snake[0].y;
+void startRoyale(GameWorld* w, int players) {
+    game_restart(w);
+    w->initial_players = players;
+    w->active_players = players;
+    updateArenaSize(w, players); // 20x20 for 10 players, etc.
+    world_reset(w);
+    reset_turn_queues(w);
+}
 
-    // Use current bounds instead of hardcoded constants
-    if (x < 0 || x >= currentWidth || y < 0 || y >= currentHeight)
-        return 1;
+// --- 4. Input Definitions ---
 
-    for (int i = 1; i < snake_length; i++) {
-        if (snake[i].x == x && snake[i].y == y)
-            return 1;
+// Keys read from stdin as soon as it is readable, consumed by the pollers.
+// Each key keeps the time it arrived so input latency can be measured.
+#define KEY_BUFFER_SIZE 64
+static char key_buffer[KEY_BUFFER_SIZE];
+static long long key_arrived_ns[KEY_BUFFER_SIZE];
+static int key_head = 0;
+static int key_count = 0;
+
+// Reads one chunk from stdin into the key buffer. Returns the bytes read,
+// 0 when there is nothing more for now, and -1 once stdin is closed. Call it
+// until it returns 0 and hand the keys out in between, so a burst longer
+// than the buffer is not cut short.
+int input_fill() {
+    char buf[KEY_BUFFER_SIZE];
+    int room = KEY_BUFFER_SIZE - key_count;
+
+    // Nobody is reading keys right now: drop them rather than leave stdin
+    // readable forever
+    ssize_t n = read(STDIN_FILENO, buf, room > 0 ? (size_t)room : sizeof(buf));
+    if (n == 0) return -1;
+    if (n < 0) return 0; // EAGAIN: nothing more for now
+    if (room == 0) return (int)n;
+
+    long long now = input_now_ns();
+    for (ssize_t i = 0; i < n; i++) {
+        int slot = (key_head + key_count) % KEY_BUFFER_SIZE;
+        key_buffer[slot] = buf[i];
+        key_arrived_ns[slot] = now;
+        key_count++;
     }
-    return 0;
-}   
-
-// Return 0: No collision, 1: P1 Died, 2: P2 Died, 3: Both Died
-int checkMultiplayerCollision() {
-    // Check P1 against dynamic walls
-    if (snake[0].x < 0 || snake[0].x >= currentWidth || snake[0].y < 0 || snake[0].y >= currentHeight) return 1;
-    for (int i = 1; i < snake_length; i++) if (snake[i].x == snake[0].x && snake[i].y == snake[0].y) return 1;
+    return (int)n;
+}
 
-    // Check P2 against dynamic walls
-    if (snake2[0].x < 0 || snake2[0].x >= currentWidth || snake2[0].y < 0 || snake2[0].y >= currentHeight) return 2;
-    for (int i = 1; i < snake2_length; i++) if (snake2[i].x == snake2[0].x && snake2[i].y == snake2[0].y) return 2;
+// Next buffered key and when it arrived; returns 1 if there was one
+static int read_timed_key(char* c, long long* arrived_ns) {
+    if (key_count == 0) return 0;
+    *c = key_buffer[key_head];
+    *arrived_ns = key_arrived_ns[key_head];
+    key_head = (key_head + 1) % KEY_BUFFER_SIZE;
+    key_count--;
+    return 1;
+}
 
-    // Check P1 Head into P2 Body
-    for (int i = 0; i < snake2_length; i++) if (snake[0].x == snake2[i].x && snake[0].y == snake2[i].y) return 1;
-    
-    // Check P2 Head into P1 Body
-    for (int i = 0; i < snake_length; i++) if (snake2[0].x == snake[i].x && snake2[0].y == snake[i].y) return 2;
+// Next buffered key; returns 1 if there was one
+int read_key(char* c) {
+    long long arrived_ns;
+    return read_timed_key(c, &arrived_ns);
+}
 
-    return 0;
+// Maps a key to a turn, or {0, 0} if it is not a direction key
+static Turn turn_for_key(char c, const char keys[4]) {
+    if (c == keys[0]) return (Turn){ 0, -1 };
+    if (c == keys[1]) return (Turn){ -1, 0 };
+    if (c == keys[2]) return (Turn){ 0, 1 };
+    if (c == keys[3]) return (Turn){ 1, 0 };
+    return (Turn){ 0, 0 };
 }
 
-// --- 4. Input Definitions ---
-void pollSinglePlayerInput() {
-    char c;
-    if (read(STDIN_FILENO, &c, 1) == 1) {
-        if (c == 'w' && dirY != 1)  { dirX = 0; dirY = -1; }
-        if (c == 's' && dirY != -1) { dirX = 0; dirY = 1; }
-        if (c == 'a' && dirX != 1)  { dirX = -1; dirY = 0; }
-        if (c == 'd' && dirX != -1) { dirX = 1; dirY = 0; }
-        
-        if (c == 'r') {
-            game_restart();
-            printf("\033[2J"); 
-        }
-        if (c == 'q') exit(0);
+// Moves every buffered key into the turn queues the moment it arrives, so
+// keys typed between two ticks are all kept rather than one per tick.
+void queueGameKeys(GameWorld* w) {
+    int local = (current_state == STATE_MULTIPLAYER_LOCAL);
+    if (!local && current_state != STATE_SINGLEPLAYER &&
+        current_state != STATE_MULTIPLAYER_ONLINE && current_state != STATE_STARVATION_ROYALE) {
+        return; // menus and game over read their keys themselves
     }
-}
 
-void pollLocalMultiplayerInput() {
+    // Each key goes to its own player's queue only, so one player holding
+    // a key down never delays the other's turns
     char c;
-    if (read(STDIN_FILENO, &c, 1) == 1) {
+    long long arrived_ns;
+    while (read_timed_key(&c, &arrived_ns)) {
         // Player 1 (WASD)
-        if (c == 'w' && dirY != 1)  { dirX = 0; dirY = -1; }
-        if (c == 's' && dirY != -1) { dirX = 0; dirY = 1; }
-        if (c == 'a' && dirX != 1)  { dirX = -1; dirY = 0; }
-        if (c == 'd' && dirX != -1) { dirX = 1; dirY = 0; }
+        turn_queue_push(&turn_queue[0], turn_for_key(c, "wasd"), arrived_ns);
 
         // Player 2 (IJKL - cleaner for terminal than escaped arrow keys)
-        if (c == 'i' && dirY2 != 1)  { dirX2 = 0; dirY2 = -1; }
-        if (c == 'k' && dirY2 != -1) { dirX2 = 0; dirY2 = 1; }
-        if (c == 'j' && dirX2 != 1)  { dirX2 = -1; dirY2 = 0; }
-        if (c == 'l' && dirX2 != -1) { dirX2 = 1; dirY2 = 0; }
-        
+        if (local) turn_queue_push(&turn_queue[1], turn_for_key(c, "ijkl"), arrived_ns);
+
+        if (c == 'r' && !local) {
+            game_restart(w);
+            printf("\033[2J"); 
+        }
         if (c == 'q') exit(0);
     }
 }
 
-void runStarvationRoyaleTick(MultiplayerApi* api) {
-    pollSinglePlayerInput();
-    moveSnake();
-    
-    royale_tick_counter++;
-    if (royale_tick_counter >= 50) {
-        if (snake_length > 2) snake_length--; 
-        royale_tick_counter = 0;
-    }
-
-    if (checkCollision()) {
-        current_state = STATE_GAME_OVER;
-    }
-
-    for (int i = 0; i < active_food_count; i++) {
-        if (snake[0].x == foodX_array[i] && snake[0].y == foodY_array[i]) {
-            snake_length += 2;
-            // Respawn just this one piece of food
-            foodX_array[i] = rand() % currentWidth;
-            foodY_array[i] = rand() % currentHeight;
-        }
-    }
+void pollSinglePlayerInput(GameWorld* w, WorldInput* in) {
+    memset(in, 0, sizeof(*in));
+    queueGameKeys(w);
+    turn_queue_pop(&turn_queue[0], &in->turn[0], input_now_ns());
+}
 
-    // Networking: You'll need to pack and mp_api_game here just like in STATE_MULTIPLAYER_ONLINE
-    draw();
+void pollLocalMultiplayerInput(GameWorld* w, WorldInput* in) {
+    memset(in, 0, sizeof(*in));
+    queueGameKeys(w);
+    long long now = input_now_ns();
+    turn_queue_pop(&turn_queue[0], &in->turn[0], now);
+    turn_queue_pop(&turn_queue[1], &in->turn[1], now);
 }
 
-void pollMenuInput() {
+void pollMenuInput(GameWorld* w) {
+    // Mode picked with 1/2, held here until ENTER starts it
+    static GameState chosen = STATE_MENU;
     char c;
-    if (read(STDIN_FILENO, &c, 1) == 1) {
+
+    while (chosen != STATE_MENU && read_key(&c)) {
+        if (c != '\n') continue;
+        current_state = chosen;
+        chosen = STATE_MENU;
+        game_restart(w);
+        printf("\033[2J");
+        return;
+    }
+    if (chosen != STATE_MENU) return;
+
+    if (read_key(&c)) {
         if (c == '1' || c == '2') {
-            // Set the state based on choice
-            current_state = (c == '1') ? STATE_SINGLEPLAYER : STATE_MULTIPLAYER_LOCAL;
+            // Remember the choice; the game starts on ENTER
+            chosen = (c == '1') ? STATE_SINGLEPLAYER : STATE_MULTIPLAYER_LOCAL;
             
             // --- THE "PRESS ENTER" FIX ---
             printf("\033[2J\033[H");
             printf("Mode: %s Selected!\nPress [ENTER] to start the game...\n", (c == '1') ? "Single Player" : "Local 1v1");
-            
-            char wait_c;
-            // Loop until Enter is pressed
-            while (read(STDIN_FILENO, &wait_c, 1) != 1 || wait_c != '\n');
-            
-            game_restart();
-            printf("\033[2J");
+            fflush(stdout);
         } 
         else if (c == '3') {
             current_state = STATE_MULTIPLAYER_HOST;
@@ -269,7 +253,8 @@ void drawMenu() {
 
     printf("Choose Mode:\n");
     printf(" 1. Single Player (Best: %d)\n", get_highscore(STATE_SINGLEPLAYER));
-    printf(" 2. Local Multiplayer (Best P1: %d, Best P2: )\n", get_highscore(STATE_MULTIPLAYER_LOCAL));
+    printf(" 2. Local Multiplayer (Best P1: %d, Best P2: %d)\n",
+           get_player_highscore(STATE_MULTIPLAYER_LOCAL, 0), get_player_highscore(STATE_MULTIPLAYER_LOCAL, 1));
     printf(" 3. Host Online Game\n");
     printf(" 4. Join Online Game\n");
     printf(" 5. Starvation Royale\n");
@@ -278,114 +263,123 @@ void drawMenu() {
     fflush(stdout);
 }
 
-void updateArenaSize(int players) {
+void updateArenaSize(GameWorld* w, int players) {
     // Example: 20x20 base + extra space per player
-    currentWidth = 20 + (players * 2);
-    currentHeight = 20 + (players * 2);
-    
-    // Cap it so it doesn't outgrow the terminal
-    if (currentWidth > 80) currentWidth = 80;
-    if (currentHeight > 40) currentHeight = 40;
+    // (world_set_arena caps it so it doesn't outgrow the terminal)
+    world_set_arena(w, 20 + (players * 2), 20 + (players * 2));
 }
 
-void draw() {
-    printf("\033[H"); 
+// What is on screen, so each frame only sends the cells that changed
+static Renderer screen = { .fd = STDOUT_FILENO };
+static GameState screen_state = STATE_MENU;
 
-    for (int x = 0; x < currentWidth + 2; x++) printf("-");
-    printf("\n");
+// Next draw() repaints everything (anything else has drawn over the board)
+void invalidateScreen() {
+    renderer_invalidate(&screen);
+}
 
-    for (int y = 0; y < currentHeight; y++) {
-        printf("|"); 
+void draw(const GameWorld* w) {
+    int has_opponent = w->player_count > 1;
 
-        for (int x = 0; x < currentWidth; x++) { 
-            
-            int isFood = 0;
-            for (int f = 0; f < active_food_count; f++) {
-                if (x == foodX_array[f] && y == foodY_array[f]) {
-                    printf("Ó");
-                    isFood = 1;
-                    break;
-                }
-            }
-            if (isFood) continue;
-
-            int printed = 0;
-            // Draw Player 1
-            for (int i = 0; i < snake_length; i++) {
-                if (snake[i].x == x && snake[i].y == y) {
-                    printf(i == 0 ? "@" : "#");
-                    printed = 1;
-                    break;
-                }
-            }
-
-            // Draw Player 2 / Online Opponent
-            if (!printed && (current_state == STATE_MULTIPLAYER_LOCAL || 
-                             current_state == STATE_MULTIPLAYER_ONLINE ||
-                             current_state == STATE_ROYALE_SPECTATOR)) {
-                for (int i = 0; i < snake2_length; i++) {
-                    if (snake2[i].x == x && snake2[i].y == y) {
-                        printf(i == 0 ? "8" : "%%");
-                        printed = 1;
-                        break;
-                    }
-                }
-            }
-
-            if (!printed) printf(" ");
-        } 
-        printf("|\n"); 
+    // A different mode means a different screen layout
+    if (current_state != screen_state) {
+        screen_state = current_state;
+        invalidateScreen();
     }
 
-    // Lower border
-    for (int x = 0; x < currentWidth + 2; x++)
-        printf("-");
-    printf("\n");
+    // Draw Player 2 / Online Opponent
+    int show_opponent = has_opponent && (current_state == STATE_MULTIPLAYER_LOCAL ||
+                                         current_state == STATE_MULTIPLAYER_ONLINE ||
+                                         current_state == STATE_ROYALE_SPECTATOR);
 
     // Dynamic Status Line
+    char status[STATUS_LINE_MAX];
     if (current_state == STATE_SINGLEPLAYER) {
-        printf("Score: %d | Best: %d\n", snake_length - 3, get_highscore(STATE_SINGLEPLAYER));
-        fflush(stdout);
+        snprintf(status, sizeof(status), "Score: %d | Best: %d",
+                 world_score(w, 0), get_highscore(STATE_SINGLEPLAYER));
     } else if (current_state == STATE_MULTIPLAYER_ONLINE) {
-        printf("YOU (@): %d | OPPONENT (8): %d [%s]\n", 
-               snake_length - 3, snake2_length - 3, is_host ? "HOST" : "GUEST");
-               fflush(stdout);
+        snprintf(status, sizeof(status), "YOU (@): %d | OPPONENT (8): %d [%s]",
+                 world_score(w, 0), has_opponent ? world_score(w, 1) : 0,
+                 connection_lost ? "CONNECTION LOST" : is_host ? "HOST" : "GUEST");
     } else {
-        printf("P1: %d | P2: %d\n", snake_length - 3, snake2_length - 3);
-        fflush(stdout);
+        snprintf(status, sizeof(status), "P1: %d | P2: %d",
+                 world_score(w, 0), has_opponent ? world_score(w, 1) : 0);
+    }
+
+    renderer_draw(&screen, w, show_opponent, status);
+}
+
+// Key-to-move latency of both local players, for the 1v1 game over screen
+void drawInputLatency() {
+    printf(" Input lag   ");
+    for (int b = 0; b < LATENCY_BUCKETS - 1; b++) printf(" <%-3ld", latency_bucket_limit_ms(b));
+    printf(" more ms\n");
+
+    for (int p = 0; p < 2; p++) {
+        const LatencyHistogram* h = &turn_queue[p].latency;
+        printf(" P%d (%s)   ", p + 1, p == 0 ? "WASD" : "IJKL");
+        for (int b = 0; b < LATENCY_BUCKETS; b++) printf(" %-4ld", h->count[b]);
+        printf("\n     avg %.1f ms, p95 <%ld ms, max %ld ms, %ld turns, %ld dropped\n",
+               latency_avg_ms(h), latency_percentile_ms(h, 95), h->max_us / 1000,
+               h->samples, turn_queue[p].dropped);
     }
 }
 
+void drawNetworkStats(MultiplayerApi* api) {
+    if (connection_lost) {
+        printf(" The server closed the connection\n");
+    }
+
+    MpApiSendStats st;
+    mp_api_send_stats(api, &st);
+    long n = st.messages ? st.messages : 1;
+    printf(" Sent %ld msgs, %.1f bytes and %.2f send() calls per msg\n",
+           st.messages, (double)st.bytes / n, (double)st.syscalls / n);
+    printf(" Send queue %d now, %d max, %ld dropped, %ld coalesced, %ld turned away\n",
+           st.queued, st.max_queued, st.dropped, st.coalesced, st.rejected);
+
+    MpApiRecvStats rx;
+    mp_api_recv_stats(api, &rx);
+    printf(" Received %ld msgs, %ld skipped as stale (%ld backlogs, largest %d)\n",
+           rx.messages, rx.skipped, rx.backlogs, rx.max_backlog);
+}
+
 // -------------------------------------
 // --- 6. Game Loop Tick Definitions ---
 // -------------------------------------
 
 // Main logic for the single-player game tick
-void runSinglePlayerGameTick(MultiplayerApi* api, json_t* gameData) {
-    pollSinglePlayerInput();
-    moveSnake();
+void runSinglePlayerGameTick(GameWorld* w) {
+    WorldInput in;
+    pollSinglePlayerInput(w, &in);
 
     // Check collision and handle Game Over
-    if (checkCollision()) {
+    if (world_step(w, &in)) {
         current_state = STATE_GAME_OVER; // Change state to Game Over
         return; // Exit the game tick immediately
     }
 
-    // Check for food consumption
-    if (snake[0].x == foodX && snake[0].y == foodY) {
-        if (snake_length < MAX_LEN)
-            snake_length++;
-        spawnFood();
+    draw(w);
+}
+
+void runLocalMultiplayerTick(GameWorld* w) {
+    WorldInput in;
+    pollLocalMultiplayerInput(w, &in);
+
+    // Either snake dying ends the round
+    if (world_step(w, &in)) {
+        current_state = STATE_GAME_OVER;
     }
 
-    draw();
-    
-    // Multiplayer logic is still called, even in SP mode (which may be odd)
-    // You should probably remove the multiplayer API calls if not hosting/joining.
-    /*
-    int rc = mp_api_game(api, gameData);
-    printf("Skickade game-data, rc=%d\n", rc);
-    */
+    draw(w);
+}
+
+int tick_rate_for_state(GameState state) {
+    switch (state) {
+        case STATE_MENU:
+        case STATE_GAME_OVER: return TICK_RATE_UI; // only waiting for a key
+        default:              return TICK_RATE_GAME;
+    }
 }
 
 // ---------------------------
@@ -402,24 +396,89 @@ const char* get_highscore_filename(GameState mode) {
     }
 }
 
-int get_highscore(GameState mode) {
-    int score = 0;
-    FILE *f = fopen(get_highscore_filename(mode), "r");
-    if (f) {
-        if (fscanf(f, "%d", &score) != 1) score = 0;
-        fclose(f);
+// Display name of a mode for the game over screen
+const char* get_mode_name(GameState mode) {
+    switch(mode) {
+        case STATE_SINGLEPLAYER:       return "Single Player";
+        case STATE_MULTIPLAYER_LOCAL:  return "Local 1v1";
+        case STATE_MULTIPLAYER_ONLINE: return "Online 1v1";
+        case STATE_STARVATION_ROYALE:  return "Starvation Royale";
+        default: return "General";
     }
-    return score;
 }
 
-void check_and_save_highscore(GameState mode, int current_score) {
-    int best = get_highscore(mode);
-    
-    if (current_score > best) {
-        FILE *f = fopen(get_highscore_filename(mode), "w");
-        if (f) {
-            fprintf(f, "%d", current_score);
+// All modes share one mmap'd leaderboard file; reads never make a syscall
+// and new scores are written in the background
+#define LEADERBOARD_FILE "leaderboard.bin"
+static HighscoreStore* highscores = NULL;
+
+static const GameState highscore_modes[] = {
+    STATE_SINGLEPLAYER, STATE_MULTIPLAYER_LOCAL, STATE_MULTIPLAYER_ONLINE,
+    STATE_STARVATION_ROYALE, STATE_MENU // STATE_MENU stands in for "general"
+};
+#define HIGHSCORE_MODE_COUNT ((int)(sizeof(highscore_modes) / sizeof(highscore_modes[0])))
+
+static int highscore_slot(GameState mode) {
+    for (int i = 0; i < HIGHSCORE_MODE_COUNT - 1; i++) {
+        if (highscore_modes[i] == mode) return i;
+    }
+    return HIGHSCORE_MODE_COUNT - 1;
+}
+
+// Local 1v1 players are P1 and P2; everywhere else it is whoever runs the
+// kiosk, from $SNAKE_PLAYER or the login name
+static const char* player_name(GameState mode, int player) {
+    if (mode == STATE_MULTIPLAYER_LOCAL) return player == 0 ? "P1" : "P2";
+
+    const char* name = getenv("SNAKE_PLAYER");
+    if (!name || !*name) name = getenv("USER");
+    return (name && *name) ? name : "player";
+}
+
+void open_highscores() {
+    if (highscores) return;
+    highscores = highscore_store_create(LEADERBOARD_FILE);
+
+    // First run with the leaderboard: bring over the old one-number files
+    if (highscore_store_is_new(highscores)) {
+        for (int i = 0; i < HIGHSCORE_MODE_COUNT; i++) {
+            int score = 0;
+            FILE *f = fopen(get_highscore_filename(highscore_modes[i]), "r");
+            if (!f) continue;
+            if (fscanf(f, "%d", &score) != 1) score = 0;
             fclose(f);
+            if (score > 0) check_and_save_highscore(highscore_modes[i], 0, score);
         }
     }
-}
\ No newline at end of file
+}
+
+// Waits for pending writes; registered with atexit() since 'q' exits anywhere
+void close_highscores() {
+    highscore_store_destroy(highscores);
+    highscores = NULL;
+}
+
+// Best score in a mode by anyone
+int get_highscore(GameState mode) {
+    return highscore_best(highscores, highscore_slot(mode), NULL);
+}
+
+// Best score in a mode of one player (0 = P1, 1 = P2)
+int get_player_highscore(GameState mode, int player) {
+    return highscore_best(highscores, highscore_slot(mode), player_name(mode, player));
+}
+
+void check_and_save_highscore(GameState mode, int player, int current_score) {
+    highscore_submit(highscores, highscore_slot(mode), player_name(mode, player), current_score);
+}
+
+// Top of a mode's leaderboard, one line each
+void drawLeaderboard(GameState mode, int rows) {
+    LeaderboardEntry top[10];
+    if (rows > 10) rows = 10;
+
+    int n = highscore_top(highscores, highscore_slot(mode), top, rows);
+    for (int i = 0; i < n; i++) {
+        printf(" %2d. %-24s %6d\033[K\n", i + 1, top[i].name, top[i].score);
+    }
+}
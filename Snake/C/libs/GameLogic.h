@@ -4,14 +4,13 @@
 #include <termios.h>
 
 #include "MultiplayerApi.h"
+#include "GameWorld.h"
+#include "InputQueue.h"
+#include "Renderer.h"
+#include "Highscore.h"
 
 // --- 1. Constants and Enums ---
 
-#define WIDTH 40
-#define HEIGHT 20
-#define MAX_LEN 200
-#define MAX_FOOD 20
-
 typedef enum {
     STATE_MENU,
     STATE_SINGLEPLAYER,
@@ -24,37 +23,25 @@ typedef enum {
     STATE_GAME_OVER
 } GameState;
 
-typedef struct {
-    int x, y;
-} Segment;
+// Ticks per second per state. Both ends of an online match must use the
+// same game rate or they drift apart.
+#define TICK_RATE_GAME 10
+#define TICK_RATE_UI 20
 
 // --- 2. Global Variables (External Declarations) ---
-
-extern int foodX_array[MAX_FOOD];
-extern int foodY_array[MAX_FOOD];
-extern int active_food_count;
+// The match itself lives in a GameWorld owned by main.c; only the terminal
+// front end's own state is global.
 
 extern int active_players;
 extern int is_host;
+extern int connection_lost; // the server hung up on the online session
 
 extern GameState current_state;
-extern Segment snake[MAX_LEN];
-extern int snake_length;
-extern int dirX;
-extern int dirY;
-extern int foodX;
-extern int foodY;
-extern Segment snake2[MAX_LEN];
-extern int snake2_length;
-extern int dirX2, dirY2;
 extern int score1, score2;
 
 extern char retry;
 extern struct termios orig; // Used by Terminal Handling functions
 
-extern int currentWidth;
-extern int currentHeight;
-
 // --- 3. Function Prototypes (Declarations) ---
 
 // -------------------------------
@@ -68,40 +55,50 @@ void disableRawMode();
 // Game Logic
 // -------------------------------
 
-void spawnFood();
-void moveSnake();
-void game_restart();
-int checkCollision();
-int checkMultiplayerCollision();
+void game_restart(GameWorld* w);
+void startRoyale(GameWorld* w, int players);
 
 // -------------------------------
 // Inmatning/Input
 // -------------------------------
 
-void pollMenuInput();
-void pollSinglePlayerInput();
-void pollLocalMultiplayerInput();
+int input_fill();
+int read_key(char* c);
+void queueGameKeys(GameWorld* w);
+void pollMenuInput(GameWorld* w);
+void pollSinglePlayerInput(GameWorld* w, WorldInput* in);
+void pollLocalMultiplayerInput(GameWorld* w, WorldInput* in);
 
 // -------------------------------
 // Draw Functions
 // -------------------------------
 
 void drawMenu();
-void draw();
-void updateArenaSize(int players);
+void draw(const GameWorld* w);
+void invalidateScreen();
+void drawInputLatency();
+void drawNetworkStats(MultiplayerApi* api);
+void updateArenaSize(GameWorld* w, int players);
 
 // -------------------------------
 // Game Loop Tick
 // -------------------------------
 
-void runSinglePlayerGameTick(MultiplayerApi* api, json_t* gameData);
+void runSinglePlayerGameTick(GameWorld* w);
+void runLocalMultiplayerTick(GameWorld* w);
+int tick_rate_for_state(GameState state);
 
 // -------------------------------
 // Highscore Prototypes
 // -------------------------------
 
 const char* get_highscore_filename(GameState mode);
+const char* get_mode_name(GameState mode);
+void open_highscores();
+void close_highscores();
 int get_highscore(GameState mode);
-void check_and_save_highscore(GameState mode, int current_score);
+int get_player_highscore(GameState mode, int player);
+void check_and_save_highscore(GameState mode, int player, int current_score);
+void drawLeaderboard(GameState mode, int rows);
 
 #endif //GAMELOGIC_H
\ No newline at end of file
@@ -0,0 +1,403 @@
+#include "GameWorld.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// --------------------------------
+// --- 1. Snake Body Definitions ---
+// --------------------------------
+
+void body_clear(SnakeBody* b) {
+    b->head = 0;
+    b->length = 0;
+    b->grow = 0;
+}
+
+// Adds a segment behind the current tail; used when building a body head-first
+void body_append(SnakeBody* b, Segment s) {
+    if (b->length >= MAX_LEN) return;
+    *body_at(b, b->length) = s;
+    b->length++;
+}
+
+// Moves the head one step. Returns 1 and stores the cell the tail left in
+// *vacated, or 0 if the snake grew this move and kept its tail.
+int body_advance(SnakeBody* b, int dx, int dy, Segment* vacated) {
+    if (b->length == 0) return 0;
+
+    Segment next = *body_at(b, 0);
+    next.x += dx;
+    next.y += dy;
+
+    int keepTail = (b->grow > 0 && b->length < MAX_LEN);
+    Segment tail = *body_at(b, b->length - 1);
+
+    b->head = (b->head + MAX_LEN - 1) % MAX_LEN;
+    b->seg[b->head] = next;
+
+    if (keepTail) {
+        b->length++;
+        b->grow--;
+        return 0;
+    }
+
+    if (vacated) *vacated = tail;
+    return 1;
+}
+
+// Growth is applied by the following moves so the new segments always
+// occupy the cells the tail is leaving.
+void body_grow(SnakeBody* b, int amount) {
+    b->grow += amount;
+    if (b->length + b->grow > MAX_LEN) b->grow = MAX_LEN - b->length;
+}
+
+// Drops the tail segment immediately (starvation). Returns 1 if removed.
+int body_shrink(SnakeBody* b, Segment* vacated) {
+    if (b->grow > 0) {
+        b->grow--;
+        return 0;
+    }
+    if (b->length == 0) return 0;
+    b->length--;
+    if (vacated) *vacated = *body_at(b, b->length);
+    return 1;
+}
+
+// Length including pending growth; this is what scores are based on
+int body_size(const SnakeBody* b) {
+    return b->length + b->grow;
+}
+
+// ------------------------------------
+// --- 2. Occupancy Grid Definitions ---
+// ------------------------------------
+
+// Empties the grid and sets the arena it covers; cells outside it read as wall
+void grid_reset(OccupancyGrid* g, int width, int height) {
+    g->width = width;
+    g->height = height;
+    memset(g->cells, 0, sizeof(Cell) * (size_t)width * (size_t)height);
+}
+
+Cell grid_at(const OccupancyGrid* g, int x, int y) {
+    if (x < 0 || x >= g->width || y < 0 || y >= g->height)
+        return (Cell){ CELL_WALL, 0 };
+    return g->cells[y * g->width + x];
+}
+
+void grid_mark(OccupancyGrid* g, Segment s, int owner) {
+    if (s.x < 0 || s.x >= g->width || s.y < 0 || s.y >= g->height) return;
+    g->cells[s.y * g->width + s.x] = (Cell){ CELL_BODY, (unsigned char)owner };
+}
+
+// Only clears the cell if it still belongs to owner, so a retracting tail
+// never erases a segment another snake has moved onto.
+void grid_unmark(OccupancyGrid* g, Segment s, int owner) {
+    if (s.x < 0 || s.x >= g->width || s.y < 0 || s.y >= g->height) return;
+    Cell* c = &g->cells[s.y * g->width + s.x];
+    if (c->kind == CELL_BODY && c->owner == owner)
+        *c = (Cell){ CELL_EMPTY, 0 };
+}
+
+// Marks every segment except the head
+void grid_add_body(OccupancyGrid* g, SnakeBody* b) {
+    for (int i = 1; i < b->length; i++)
+        grid_mark(g, *body_at(b, i), b->id);
+}
+
+void grid_remove_body(OccupancyGrid* g, SnakeBody* b) {
+    for (int i = 1; i < b->length; i++)
+        grid_unmark(g, *body_at(b, i), b->id);
+}
+
+// ---------------------------
+// --- 3. World Definitions ---
+// ---------------------------
+
+// xorshift32, so every world has its own reproducible food sequence
+unsigned int world_rand(GameWorld* w) {
+    unsigned int x = w->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    w->rng = x;
+    return x;
+}
+
+int world_score(const GameWorld* w, int player) {
+    return body_size(&w->players[player].body) - 3;
+}
+
+int world_alive_count(const GameWorld* w) {
+    int alive = 0;
+    for (int p = 0; p < w->player_count; p++)
+        alive += w->players[p].alive;
+    return alive;
+}
+
+static void rebuild_grid(GameWorld* w) {
+    grid_reset(&w->grid, w->width, w->height);
+    for (int p = 0; p < w->player_count; p++)
+        grid_add_body(&w->grid, &w->players[p].body);
+}
+
+static void spawn_food(GameWorld* w, int i) {
+    w->foodX[i] = world_rand(w) % w->width;
+    w->foodY[i] = world_rand(w) % w->height;
+}
+
+// Player 1 starts mid-left heading right, player 2 mid-right heading left;
+// any further (royale) players get their own row.
+static void place_player(GameWorld* w, int p) {
+    Player* pl = &w->players[p];
+    int x, y;
+
+    if (p == 0) {
+        x = w->width / 2; y = w->height / 2;
+        pl->dirX = 1; pl->dirY = 0;
+    } else if (p == 1) {
+        x = w->width - 6; y = w->height / 2;
+        pl->dirX = -1; pl->dirY = 0;
+    } else {
+        x = w->width / 4; y = (w->height * (p - 1)) / w->player_count;
+        pl->dirX = 1; pl->dirY = 0;
+    }
+
+    body_clear(&pl->body);
+    pl->body.id = p + 1;
+    for (int i = 0; i < 3; i++)
+        body_append(&pl->body, (Segment){ x - i * pl->dirX, y - i * pl->dirY });
+    pl->alive = 1;
+}
+
+void world_init(GameWorld* w, WorldMode mode, int players, unsigned int seed) {
+    memset(w, 0, sizeof(*w));
+
+    if (players < 1) players = 1;
+    if (players > MAX_PLAYERS) players = MAX_PLAYERS;
+
+    w->mode = mode;
+    w->width = WIDTH;
+    w->height = HEIGHT;
+    w->player_count = players;
+    w->owns_food = 1;
+    w->rng = seed ? seed : 0x9E3779B9u;
+    w->initial_players = players;
+    w->active_players = players;
+
+    // The online opponent is driven entirely by incoming game messages
+    if (mode == WORLD_ONLINE && players > 1)
+        w->players[1].remote = 1;
+
+    world_reset(w);
+}
+
+// Puts every snake back at its start position and respawns the food, keeping
+// mode, arena size and random sequence.
+void world_reset(GameWorld* w) {
+    w->tick = 0;
+    w->starve_counter = 0;
+
+    for (int p = 0; p < w->player_count; p++)
+        place_player(w, p);
+    rebuild_grid(w);
+
+    // 10 players = 5 food; 5 players = 2 food
+    w->food_count = 1;
+    if (w->mode == WORLD_ROYALE && w->active_players / 2 > 1)
+        w->food_count = w->active_players / 2;
+    if (w->food_count > MAX_FOOD) w->food_count = MAX_FOOD;
+
+    for (int i = 0; i < w->food_count; i++)
+        spawn_food(w, i);
+}
+
+void world_set_arena(GameWorld* w, int width, int height) {
+    // Cap it so it doesn't outgrow the terminal (or the grid)
+    if (width > MAX_WIDTH) width = MAX_WIDTH;
+    if (height > MAX_HEIGHT) height = MAX_HEIGHT;
+    if (width < 1) width = 1;
+    if (height < 1) height = 1;
+
+    w->width = width;
+    w->height = height;
+    rebuild_grid(w);
+}
+
+void world_set_body(GameWorld* w, int player, const Segment* segs, int count) {
+    if (player < 0 || player >= w->player_count) return;
+    SnakeBody* b = &w->players[player].body;
+
+    grid_remove_body(&w->grid, b);
+    body_clear(b);
+    for (int i = 0; i < count && i < MAX_LEN; i++)
+        body_append(b, segs[i]);
+    grid_add_body(&w->grid, b);
+}
+
+void world_set_food(GameWorld* w, const int* xs, const int* ys, int count) {
+    if (count > MAX_FOOD) count = MAX_FOOD;
+    if (count < 0) count = 0;
+    for (int i = 0; i < count; i++) {
+        w->foodX[i] = xs[i];
+        w->foodY[i] = ys[i];
+    }
+    w->food_count = count;
+}
+
+static int is_stepped(const Player* pl) {
+    return pl->alive && !pl->remote && pl->body.length > 0;
+}
+
+// Keeps the grid in step with the move: the old head becomes body and the
+// cell the tail left is released.
+static void move_player(GameWorld* w, Player* pl) {
+    SnakeBody* b = &pl->body;
+    Segment vacated;
+
+    grid_mark(&w->grid, *body_at(b, 0), b->id);
+    if (body_advance(b, pl->dirX, pl->dirY, &vacated))
+        grid_unmark(&w->grid, vacated, b->id);
+}
+
+static int has_collided(const GameWorld* w, int p) {
+    const Player* pl = &w->players[p];
+    Segment h = *body_at_const(&pl->body, 0);
+    Cell c = grid_at(&w->grid, h.x, h.y);
+
+    if (c.kind == CELL_WALL) return 1;
+    if (c.kind == CELL_BODY && c.owner == pl->body.id) return 1;
+
+    // Only local 1v1 makes the other snake solid, heads included
+    if (w->mode != WORLD_LOCAL_1V1) return 0;
+    if (c.kind == CELL_BODY) return 1;
+
+    for (int o = 0; o < w->player_count; o++) {
+        if (o == p || !w->players[o].alive) continue;
+        const Segment* oh = body_at_const(&w->players[o].body, 0);
+        if (oh->x == h.x && oh->y == h.y) return 1;
+    }
+    return 0;
+}
+
+// Advances the world one tick. Returns a bitmask of the players that died
+// this tick (bit 0 = player 1, bit 1 = player 2, ...).
+int world_step(GameWorld* w, const WorldInput* in) {
+    int died = 0;
+    w->tick++;
+
+    // Turns; reversing straight into yourself is ignored
+    for (int p = 0; p < w->player_count; p++) {
+        Player* pl = &w->players[p];
+        if (!is_stepped(pl) || !in) continue;
+
+        Turn t = in->turn[p];
+        if (t.dirX == 0 && t.dirY == 0) continue;
+        if (t.dirX == -pl->dirX && t.dirY == -pl->dirY) continue;
+        pl->dirX = t.dirX;
+        pl->dirY = t.dirY;
+    }
+
+    for (int p = 0; p < w->player_count; p++) {
+        if (is_stepped(&w->players[p]))
+            move_player(w, &w->players[p]);
+    }
+
+    if (w->mode == WORLD_ROYALE) {
+        // SHRINK LOGIC: If half the players are gone, shrink map 1.5x
+        if (w->active_players <= w->initial_players / 2) {
+            int newWidth = w->width / 1.5;
+            int newHeight = w->height / 1.5;
+            // Ensure we don't shrink to 0
+            if (newWidth < 5) newWidth = 5;
+            if (newHeight < 5) newHeight = 5;
+            if (newWidth != w->width || newHeight != w->height)
+                world_set_arena(w, newWidth, newHeight);
+        }
+
+        // Starvation: everyone loses a segment every 50 ticks
+        w->starve_counter++;
+        if (w->starve_counter >= 50) {
+            for (int p = 0; p < w->player_count; p++) {
+                Player* pl = &w->players[p];
+                Segment vacated;
+                if (!is_stepped(pl) || pl->body.length <= 2) continue;
+                if (body_shrink(&pl->body, &vacated))
+                    grid_unmark(&w->grid, vacated, pl->body.id);
+            }
+            w->starve_counter = 0;
+        }
+    }
+
+    // Collisions are judged only after every snake has moved
+    for (int p = 0; p < w->player_count; p++) {
+        if (is_stepped(&w->players[p]) && has_collided(w, p))
+            died |= 1 << p;
+    }
+    for (int p = 0; p < w->player_count; p++) {
+        if (died & (1 << p)) w->players[p].alive = 0;
+    }
+
+    if (!w->owns_food) return died;
+
+    for (int p = 0; p < w->player_count; p++) {
+        Player* pl = &w->players[p];
+        if (!is_stepped(pl)) continue;
+
+        const Segment* h = body_at(&pl->body, 0);
+        for (int i = 0; i < w->food_count; i++) {
+            if (h->x == w->foodX[i] && h->y == w->foodY[i]) {
+                body_grow(&pl->body, w->mode == WORLD_ROYALE ? 2 : 1);
+                // Respawn just this one piece of food
+                spawn_food(w, i);
+            }
+        }
+    }
+
+    return died;
+}
+
+// --------------------------
+// --- 4. Bot Definitions ---
+// --------------------------
+
+static int food_distance(const GameWorld* w, int x, int y) {
+    int best = w->width + w->height;
+    for (int i = 0; i < w->food_count; i++) {
+        int d = abs(x - w->foodX[i]) + abs(y - w->foodY[i]);
+        if (d < best) best = d;
+    }
+    return best;
+}
+
+// Greedy bot for headless rooms: of straight on, left and right it takes the
+// free cell closest to food, and keeps going if all three are blocked.
+void world_bot_input(const GameWorld* w, WorldInput* in) {
+    memset(in, 0, sizeof(*in));
+
+    for (int p = 0; p < w->player_count; p++) {
+        const Player* pl = &w->players[p];
+        if (!is_stepped(pl)) continue;
+
+        const Segment* h = body_at_const(&pl->body, 0);
+        Turn options[3] = {
+            { pl->dirX, pl->dirY },
+            { pl->dirY, -pl->dirX },
+            { -pl->dirY, pl->dirX }
+        };
+        int bestDist = -1;
+
+        for (int o = 0; o < 3; o++) {
+            int nx = h->x + options[o].dirX;
+            int ny = h->y + options[o].dirY;
+            if (grid_at(&w->grid, nx, ny).kind != CELL_EMPTY) continue;
+
+            int d = food_distance(w, nx, ny);
+            if (bestDist < 0 || d < bestDist) {
+                bestDist = d;
+                in->turn[p] = options[o];
+            }
+        }
+    }
+}
@@ -0,0 +1,142 @@
+#ifndef GAMEWORLD_H
+#define GAMEWORLD_H
+
+// Headless simulation core. Everything a match needs lives in a GameWorld,
+// and nothing in here touches the terminal, the network or any global, so
+// any number of worlds can be stepped side by side in one process.
+
+// --- 1. Constants ---
+
+#define WIDTH 40
+#define HEIGHT 20
+#define MAX_LEN 200
+#define MAX_FOOD 20
+#define MAX_WIDTH 80  // Largest arena updateArenaSize() can produce
+#define MAX_HEIGHT 40
+#define MAX_PLAYERS 10
+
+typedef struct {
+    int x, y;
+} Segment;
+
+// --- 2. Snake Body ---
+
+// Snake body kept in a ring buffer so a move is O(1): the new head is
+// written one slot before the old head and the tail simply falls off the
+// end, instead of shifting every segment down each tick.
+typedef struct {
+    Segment seg[MAX_LEN];
+    int head;   // slot holding segment 0 (the head)
+    int length; // number of live segments
+    int grow;   // segments still to be added by upcoming moves
+    int id;     // owner id written into the occupancy grid
+} SnakeBody;
+
+// Segment i counted from the head (0 = head, length - 1 = tail)
+static inline Segment* body_at(SnakeBody* b, int i) {
+    return &b->seg[(b->head + i) % MAX_LEN];
+}
+
+static inline const Segment* body_at_const(const SnakeBody* b, int i) {
+    return &b->seg[(b->head + i) % MAX_LEN];
+}
+
+void body_clear(SnakeBody* b);
+void body_append(SnakeBody* b, Segment s);
+int body_advance(SnakeBody* b, int dx, int dy, Segment* vacated);
+void body_grow(SnakeBody* b, int amount);
+int body_shrink(SnakeBody* b, Segment* vacated);
+int body_size(const SnakeBody* b);
+
+// --- 3. Occupancy Grid ---
+
+// What occupies an arena cell. Heads are never stored: a head's cell is
+// marked as body when the head moves on, so looking up the cell a head just
+// entered tells us what it ran into.
+typedef enum {
+    CELL_EMPTY = 0,
+    CELL_BODY,
+    CELL_WALL
+} CellKind;
+
+typedef struct {
+    unsigned char kind;  // CellKind
+    unsigned char owner; // SnakeBody.id when kind == CELL_BODY
+} Cell;
+
+typedef struct {
+    Cell cells[MAX_WIDTH * MAX_HEIGHT];
+    int width, height;
+} OccupancyGrid;
+
+void grid_reset(OccupancyGrid* g, int width, int height);
+Cell grid_at(const OccupancyGrid* g, int x, int y);
+void grid_mark(OccupancyGrid* g, Segment s, int owner);
+void grid_unmark(OccupancyGrid* g, Segment s, int owner);
+void grid_add_body(OccupancyGrid* g, SnakeBody* b);
+void grid_remove_body(OccupancyGrid* g, SnakeBody* b);
+
+// --- 4. World ---
+
+typedef enum {
+    WORLD_SINGLEPLAYER,
+    WORLD_LOCAL_1V1,  // Both snakes local, bodies are solid to each other
+    WORLD_ONLINE,     // Player 1 is the remote opponent, fed by the network
+    WORLD_ROYALE      // Starvation, several foods and a shrinking arena
+} WorldMode;
+
+typedef struct {
+    SnakeBody body;
+    int dirX, dirY;
+    int alive;
+    int remote; // Body is set from outside, world_step() never moves it
+} Player;
+
+typedef struct {
+    WorldMode mode;
+    int width, height;
+    OccupancyGrid grid;
+
+    Player players[MAX_PLAYERS];
+    int player_count;
+
+    int foodX[MAX_FOOD];
+    int foodY[MAX_FOOD];
+    int food_count;
+    int owns_food; // Spawns and eats food (offline or hosting)
+
+    unsigned int rng;
+    long tick;
+    int starve_counter;
+
+    // Royale: the arena shrinks once half of the starting players are gone
+    int initial_players;
+    int active_players;
+} GameWorld;
+
+// Requested turn per player; {0, 0} keeps the current direction
+typedef struct {
+    int dirX, dirY;
+} Turn;
+
+typedef struct {
+    Turn turn[MAX_PLAYERS];
+} WorldInput;
+
+void world_init(GameWorld* w, WorldMode mode, int players, unsigned int seed);
+void world_reset(GameWorld* w);
+int world_step(GameWorld* w, const WorldInput* in);
+
+void world_set_arena(GameWorld* w, int width, int height);
+void world_set_body(GameWorld* w, int player, const Segment* segs, int count);
+void world_set_food(GameWorld* w, const int* xs, const int* ys, int count);
+
+unsigned int world_rand(GameWorld* w);
+int world_score(const GameWorld* w, int player);
+int world_alive_count(const GameWorld* w);
+
+// --- 5. Bots ---
+
+void world_bot_input(const GameWorld* w, WorldInput* in);
+
+#endif //GAMEWORLD_H
@@ -0,0 +1,300 @@
+#include "Highscore.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define PENDING_MAX 16 // scores queued for the writer
+
+typedef struct {
+    int mode;
+    char name[LEADERBOARD_NAME_MAX];
+    int score;
+    int64_t when;
+} PendingScore;
+
+struct HighscoreStore {
+    LeaderboardFile *file; // the mapping
+    int fd;                // -1 when the mapping is memory only
+    int is_new;
+
+    pthread_t writer;
+    int writer_started;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    PendingScore pending[PENDING_MAX];
+    int pending_count;
+    int stopping;
+};
+
+// --- Reading ---
+// The writer only touches the copy that is not live, and bumps generation
+// before it starts writing it. That copy was live until the last flip, so a
+// reader may still be in it; such a reader loaded generation before the
+// bump, sees it change under it and simply reads again.
+
+static uint64_t load_generation(const LeaderboardFile *f) {
+    return __atomic_load_n(&f->generation, __ATOMIC_ACQUIRE);
+}
+
+static const LeaderboardCopy *live_copy(const LeaderboardFile *f) {
+    return &f->copy[__atomic_load_n(&f->active, __ATOMIC_ACQUIRE) & 1];
+}
+
+static int read_done(const LeaderboardFile *f, uint64_t generation) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return load_generation(f) == generation;
+}
+
+int highscore_best(HighscoreStore *hs, int mode, const char *name) {
+    if (!hs || mode < 0 || mode >= LEADERBOARD_MODES) return 0;
+
+    int best;
+    uint64_t generation;
+    do {
+        generation = load_generation(hs->file);
+        const LeaderboardTable *t = &live_copy(hs->file)->modes[mode];
+        int count = t->count < LEADERBOARD_TOP ? t->count : LEADERBOARD_TOP;
+
+        best = 0;
+        for (int i = 0; i < count; i++) {
+            if (!name || strncmp(t->entries[i].name, name, LEADERBOARD_NAME_MAX) == 0) {
+                best = t->entries[i].score; // sorted, so the first match is the best
+                break;
+            }
+        }
+    } while (!read_done(hs->file, generation));
+    return best;
+}
+
+int highscore_top(HighscoreStore *hs, int mode, LeaderboardEntry *out, int max) {
+    if (!hs || mode < 0 || mode >= LEADERBOARD_MODES || max <= 0) return 0;
+
+    int n;
+    uint64_t generation;
+    do {
+        generation = load_generation(hs->file);
+        const LeaderboardTable *t = &live_copy(hs->file)->modes[mode];
+        n = t->count < max ? t->count : max;
+        if (n > LEADERBOARD_TOP) n = LEADERBOARD_TOP;
+        if (n < 0) n = 0;
+        memcpy(out, t->entries, (size_t)n * sizeof(LeaderboardEntry));
+    } while (!read_done(hs->file, generation));
+
+    for (int i = 0; i < n; i++) out[i].name[LEADERBOARD_NAME_MAX - 1] = '\0';
+    return n;
+}
+
+// --- Writing ---
+
+// Puts p into its table, keeping one entry per name and the best first
+static void table_insert(LeaderboardTable *t, const PendingScore *p) {
+    int count = t->count;
+    if (count < 0) count = 0;
+    if (count > LEADERBOARD_TOP) count = LEADERBOARD_TOP;
+
+    for (int i = 0; i < count; i++) {
+        if (strncmp(t->entries[i].name, p->name, LEADERBOARD_NAME_MAX) != 0) continue;
+        if (t->entries[i].score >= p->score) return; // already has a better one
+        memmove(&t->entries[i], &t->entries[i + 1], (size_t)(count - i - 1) * sizeof(LeaderboardEntry));
+        count--;
+        break;
+    }
+
+    int at = 0;
+    while (at < count && t->entries[at].score >= p->score) at++;
+    if (at == LEADERBOARD_TOP) return; // not good enough for a full board
+
+    if (count == LEADERBOARD_TOP) count--; // the last one falls off
+    memmove(&t->entries[at + 1], &t->entries[at], (size_t)(count - at) * sizeof(LeaderboardEntry));
+
+    LeaderboardEntry *e = &t->entries[at];
+    memset(e, 0, sizeof(*e));
+    memcpy(e->name, p->name, LEADERBOARD_NAME_MAX);
+    e->score = p->score;
+    e->when = p->when;
+    t->count = count + 1;
+}
+
+// Builds the next copy from the live one plus the batch, syncs it, then
+// makes it live. Only the writer thread (or destroy) calls this. Other
+// processes may have the same file mapped, so a file lock keeps their
+// writers out; active and generation are only read once it is held.
+static void publish(HighscoreStore *hs, const PendingScore *batch, int n) {
+    LeaderboardFile *f = hs->file;
+    if (hs->fd >= 0) flock(hs->fd, LOCK_EX);
+    uint32_t next = (__atomic_load_n(&f->active, __ATOMIC_ACQUIRE) & 1) ^ 1;
+
+    // generation first: readers still in the copy being reused must notice,
+    // and the fence keeps the writes below from moving ahead of the bump
+    __atomic_store_n(&f->generation, f->generation + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memcpy(&f->copy[next], &f->copy[f->active & 1], sizeof(LeaderboardCopy));
+    for (int i = 0; i < n; i++) {
+        table_insert(&f->copy[next].modes[batch[i].mode], &batch[i]);
+    }
+    if (hs->fd >= 0) msync(&f->copy[next], sizeof(LeaderboardCopy), MS_SYNC);
+
+    __atomic_store_n(&f->active, next, __ATOMIC_RELEASE);
+    if (hs->fd >= 0) {
+        msync(f, 4096, MS_SYNC);
+        flock(hs->fd, LOCK_UN);
+    }
+}
+
+static void *writer_main(void *arg) {
+    HighscoreStore *hs = (HighscoreStore *)arg;
+    PendingScore batch[PENDING_MAX];
+
+    pthread_mutex_lock(&hs->lock);
+    for (;;) {
+        while (hs->pending_count > 0) {
+            int n = hs->pending_count;
+            memcpy(batch, hs->pending, (size_t)n * sizeof(PendingScore));
+            hs->pending_count = 0;
+
+            pthread_mutex_unlock(&hs->lock);
+            publish(hs, batch, n);
+            pthread_mutex_lock(&hs->lock);
+        }
+        if (hs->stopping) break;
+        pthread_cond_wait(&hs->wake, &hs->lock);
+    }
+    pthread_mutex_unlock(&hs->lock);
+    return NULL;
+}
+
+int highscore_submit(HighscoreStore *hs, int mode, const char *name, int score) {
+    if (!hs || mode < 0 || mode >= LEADERBOARD_MODES || !name) return 0;
+
+    int improved = score > highscore_best(hs, mode, name);
+    if (!improved) return 0;
+
+    pthread_mutex_lock(&hs->lock);
+    if (hs->pending_count < PENDING_MAX) {
+        PendingScore *p = &hs->pending[hs->pending_count++];
+        memset(p, 0, sizeof(*p));
+        p->mode = mode;
+        snprintf(p->name, sizeof(p->name), "%s", name);
+        p->score = score;
+        p->when = (int64_t)time(NULL);
+        pthread_cond_signal(&hs->wake);
+    } else {
+        improved = 0;
+    }
+    pthread_mutex_unlock(&hs->lock);
+    return improved;
+}
+
+// --- Opening ---
+
+static int header_ok(const LeaderboardFile *f) {
+    return f->magic == LEADERBOARD_MAGIC && f->version == LEADERBOARD_VERSION &&
+           f->modes == LEADERBOARD_MODES && f->top == LEADERBOARD_TOP && f->active <= 1;
+}
+
+static void header_init(LeaderboardFile *f) {
+    memset(f, 0, sizeof(*f));
+    f->magic = LEADERBOARD_MAGIC;
+    f->version = LEADERBOARD_VERSION;
+    f->modes = LEADERBOARD_MODES;
+    f->top = LEADERBOARD_TOP;
+}
+
+// Maps path read-write; a missing, short or other-version file is reset
+static LeaderboardFile *map_file(HighscoreStore *hs, const char *path) {
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return NULL;
+
+    // Another process may be creating or writing it right now; closing the
+    // fd on an error path drops the lock too
+    flock(fd, LOCK_EX);
+
+    struct stat st;
+    int fresh = fstat(fd, &st) != 0 || st.st_size != (off_t)sizeof(LeaderboardFile);
+    if (fresh && ftruncate(fd, sizeof(LeaderboardFile)) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    LeaderboardFile *f = mmap(NULL, sizeof(LeaderboardFile), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (f == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    if (fresh || !header_ok(f)) {
+        header_init(f);
+        msync(f, sizeof(LeaderboardFile), MS_SYNC);
+    }
+    flock(fd, LOCK_UN);
+    hs->fd = fd;
+    return f;
+}
+
+HighscoreStore *highscore_store_create(const char *path) {
+    HighscoreStore *hs = (HighscoreStore *)calloc(1, sizeof(HighscoreStore));
+    if (!hs) return NULL;
+    hs->fd = -1;
+
+    hs->file = path ? map_file(hs, path) : NULL;
+    if (!hs->file) {
+        // Keep scores for this session at least
+        hs->file = mmap(NULL, sizeof(LeaderboardFile), PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (hs->file == MAP_FAILED) {
+            free(hs);
+            return NULL;
+        }
+        header_init(hs->file);
+    }
+    hs->is_new = (hs->file->generation == 0);
+
+    if (pthread_mutex_init(&hs->lock, NULL) != 0) goto fail_map;
+    if (pthread_cond_init(&hs->wake, NULL) != 0) goto fail_lock;
+
+    // Without a writer thread, destroy still writes everything out
+    hs->writer_started = (pthread_create(&hs->writer, NULL, writer_main, hs) == 0);
+    return hs;
+
+fail_lock:
+    pthread_mutex_destroy(&hs->lock);
+fail_map:
+    munmap(hs->file, sizeof(LeaderboardFile));
+    if (hs->fd >= 0) close(hs->fd);
+    free(hs);
+    return NULL;
+}
+
+void highscore_store_destroy(HighscoreStore *hs) {
+    if (!hs) return;
+
+    pthread_mutex_lock(&hs->lock);
+    hs->stopping = 1;
+    pthread_cond_signal(&hs->wake);
+    pthread_mutex_unlock(&hs->lock);
+
+    if (hs->writer_started) {
+        pthread_join(hs->writer, NULL);
+    } else if (hs->pending_count > 0) {
+        publish(hs, hs->pending, hs->pending_count);
+    }
+
+    pthread_cond_destroy(&hs->wake);
+    pthread_mutex_destroy(&hs->lock);
+    munmap(hs->file, sizeof(LeaderboardFile));
+    if (hs->fd >= 0) close(hs->fd);
+    free(hs);
+}
+
+int highscore_store_is_new(const HighscoreStore *hs) {
+    return hs ? hs->is_new : 0;
+}
@@ -0,0 +1,73 @@
+#ifndef HIGHSCORE_H
+#define HIGHSCORE_H
+
+#include <stdint.h>
+
+// Leaderboard kept in one memory-mapped binary file: the top
+// LEADERBOARD_TOP entries per mode, best first, with each player name at
+// most once per mode. Reads go straight to the mapping, so drawing a score
+// or a whole list costs no syscalls.
+//
+// The file holds two copies of the tables and a header saying which one is
+// live. A new score is written by a background thread into the other copy,
+// synced to disk, and only then made live by flipping the header, so a
+// crash at any point leaves one complete, consistent copy.
+
+#define LEADERBOARD_MAGIC 0x4c4b4e53u // "SNKL"
+#define LEADERBOARD_VERSION 1
+#define LEADERBOARD_MODES 8
+#define LEADERBOARD_TOP 512
+#define LEADERBOARD_NAME_MAX 24
+
+typedef struct {
+    char name[LEADERBOARD_NAME_MAX]; // NUL-terminated
+    int32_t score;
+    int32_t reserved;
+    int64_t when;                    // unix time of the score
+} LeaderboardEntry;
+
+typedef struct {
+    int32_t count;
+    int32_t reserved;
+    LeaderboardEntry entries[LEADERBOARD_TOP]; // highest score first
+} LeaderboardTable;
+
+typedef struct {
+    LeaderboardTable modes[LEADERBOARD_MODES];
+} LeaderboardCopy;
+
+// On-disk layout; the copies are page aligned so each can be synced alone
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t modes;
+    uint32_t top;
+    uint32_t active;     // copy that is live, 0 or 1
+    uint32_t reserved;
+    uint64_t generation; // bumped before each write into the copy that is not live
+    _Alignas(4096) LeaderboardCopy copy[2];
+} LeaderboardFile;
+
+typedef struct HighscoreStore HighscoreStore;
+
+/* Maps path, creating it (or replacing one of another version) if needed.
+   If the file cannot be used the scores are kept in memory only.
+   Returns NULL on error. */
+HighscoreStore *highscore_store_create(const char *path);
+
+/* Writes out anything still pending, then unmaps the file. */
+void highscore_store_destroy(HighscoreStore *hs);
+
+/* 1 if the file had no scores yet when it was opened. */
+int highscore_store_is_new(const HighscoreStore *hs);
+
+/* Best score in mode, of name or of anyone when name is NULL. */
+int highscore_best(HighscoreStore *hs, int mode, const char *name);
+
+/* Up to max entries of mode, best first. Returns how many were copied. */
+int highscore_top(HighscoreStore *hs, int mode, LeaderboardEntry *out, int max);
+
+/* Queues score for the writer thread. Returns 1 if it beats name's best. */
+int highscore_submit(HighscoreStore *hs, int mode, const char *name, int score);
+
+#endif //HIGHSCORE_H
@@ -0,0 +1,95 @@
+#include "InputQueue.h"
+
+#include <string.h>
+#include <time.h>
+
+// Monotonic timestamp used for key arrival and tick times
+long long input_now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (long long)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// Empties the queue and its histogram; current is the direction the snake
+// is moving in now
+void turn_queue_reset(TurnQueue *q, Turn current) {
+    memset(q, 0, sizeof(*q));
+    q->last = current;
+}
+
+// Queues a turn unless it repeats or reverses the last queued direction
+// (checked against the queue, not the snake, since the snake has not turned
+// yet). Returns 1 if the turn was queued.
+int turn_queue_push(TurnQueue *q, Turn t, long long arrived_ns) {
+    if (t.dirX == 0 && t.dirY == 0) return 0;
+    if (t.dirX == q->last.dirX && t.dirY == q->last.dirY) return 0;
+    if (t.dirX == -q->last.dirX && t.dirY == -q->last.dirY) return 0;
+
+    if (q->count == TURN_QUEUE_SIZE) {
+        q->dropped++;
+        return 0;
+    }
+
+    QueuedTurn *slot = &q->turns[(q->head + q->count) % TURN_QUEUE_SIZE];
+    slot->turn = t;
+    slot->arrived_ns = arrived_ns;
+    q->count++;
+    q->last = t;
+    return 1;
+}
+
+// Takes the oldest turn and records how long its key waited for the tick;
+// returns 0 (and a {0, 0} turn) when empty
+int turn_queue_pop(TurnQueue *q, Turn *out, long long now_ns) {
+    if (q->count == 0) {
+        *out = (Turn){ 0, 0 };
+        return 0;
+    }
+
+    const QueuedTurn *slot = &q->turns[q->head];
+    *out = slot->turn;
+    latency_record(&q->latency, (long)((now_ns - slot->arrived_ns) / 1000));
+
+    q->head = (q->head + 1) % TURN_QUEUE_SIZE;
+    q->count--;
+    return 1;
+}
+
+void latency_record(LatencyHistogram *h, long us) {
+    if (us < 0) us = 0;
+
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && us >= latency_bucket_limit_ms(bucket) * 1000)
+        bucket++;
+
+    h->count[bucket]++;
+    h->samples++;
+    h->total_us += us;
+    if (us > h->max_us) h->max_us = us;
+}
+
+// Upper bound of a bucket in ms; the last bucket has none and returns -1
+long latency_bucket_limit_ms(int bucket) {
+    if (bucket < 0 || bucket >= LATENCY_BUCKETS - 1) return -1;
+    return 1L << bucket;
+}
+
+// Upper bound of the bucket holding the pct-th percentile sample, or the
+// slowest sample seen when that lands in the open-ended last bucket
+long latency_percentile_ms(const LatencyHistogram *h, double pct) {
+    if (h->samples == 0) return 0;
+
+    long want = (long)(h->samples * pct / 100.0 + 0.5);
+    if (want < 1) want = 1;
+
+    long seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS - 1; b++) {
+        seen += h->count[b];
+        if (seen >= want) return latency_bucket_limit_ms(b);
+    }
+    return h->max_us / 1000;
+}
+
+double latency_avg_ms(const LatencyHistogram *h) {
+    return h->samples ? h->total_us / 1000.0 / h->samples : 0;
+}
@@ -0,0 +1,53 @@
+#ifndef INPUTQUEUE_H
+#define INPUTQUEUE_H
+
+#include "GameWorld.h"
+
+// Bounded per-player queue of direction changes. Every key that arrives is
+// queued at once and the tick takes one turn per step, so a quick "w then d"
+// becomes two consecutive turns instead of a dropped key, and typing faster
+// than the snake moves can never build up more than TURN_QUEUE_SIZE ticks of
+// lag.
+//
+// Turns carry the time their key arrived, and taking one records how long
+// it waited, so local 1v1 can show both players get the same response time.
+
+#define TURN_QUEUE_SIZE 4
+
+// Key-to-tick latency in power-of-two millisecond buckets:
+// <1, <2, <4, ... <512 ms, and everything slower in the last one
+#define LATENCY_BUCKETS 11
+
+typedef struct {
+    long count[LATENCY_BUCKETS];
+    long samples;
+    long long total_us;
+    long max_us;
+} LatencyHistogram;
+
+typedef struct {
+    Turn turn;
+    long long arrived_ns;
+} QueuedTurn;
+
+typedef struct {
+    QueuedTurn turns[TURN_QUEUE_SIZE];
+    int head;
+    int count;
+    Turn last;      // direction the snake has once every queued turn is taken
+    long dropped;   // turns rejected because the queue was full
+    LatencyHistogram latency;
+} TurnQueue;
+
+long long input_now_ns(void);
+
+void turn_queue_reset(TurnQueue *q, Turn current);
+int turn_queue_push(TurnQueue *q, Turn t, long long arrived_ns);
+int turn_queue_pop(TurnQueue *q, Turn *out, long long now_ns);
+
+void latency_record(LatencyHistogram *h, long us);
+long latency_bucket_limit_ms(int bucket);
+long latency_percentile_ms(const LatencyHistogram *h, double pct);
+double latency_avg_ms(const LatencyHistogram *h);
+
+#endif //INPUTQUEUE_H
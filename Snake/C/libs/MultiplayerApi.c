@@ -10,19 +10,60 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
+#include <stdatomic.h>
 
-typedef struct ListenerNode {
-    int id;
-    MultiplayerListener cb;
-    void *user_data;
-    struct ListenerNode *next;
-} ListenerNode;
+#include "SpscQueue.h"
 
-typedef struct ListenerSnapshot {
+#define MP_API_EVENT_QUEUE 256 /* platser i kön för MP_API_DELIVER_QUEUED */
+#define MP_API_RX_SIZE 65536   /* mottagningsbuffert; växer bara för längre rader */
+#define MP_API_RX_MIN_READ 4096 /* minsta lediga plats för en recv */
+#define MP_API_TX_SIZE 1024     /* startstorlek för sändbufferten */
+#define MP_API_SKIP_MAX 256     /* rader som kan hoppas över per mottagning */
+#define MP_API_CONFLATE_CLIENTS 16 /* avsändare som hålls isär per mottagning */
+
+typedef struct ListenerEntry {
+    int id;
     MultiplayerListener cb;
     void *user_data;
-} ListenerSnapshot;
+} ListenerEntry;
+
+/* Oföränderlig lista över lyssnare. mp_api_listen/mp_api_unlisten bygger
+   en ny kopia och byter pekaren atomiskt; den gamla frigörs först när
+   ingen dispatch längre kan läsa den (se retire_listeners). */
+typedef struct ListenerArray {
+    struct ListenerArray *retired_next; /* kedja av väntande att frigöras */
+    int count;
+    ListenerEntry items[];              /* nyaste först */
+} ListenerArray;
+
+/* En växande buffert med ett serialiserat meddelande inklusive '\n'. */
+typedef struct TxSlot {
+    char *buf;
+    size_t len;
+    size_t cap;
+    int state; /* hela avsändarens tillstånd; får ersättas av ett nyare */
+} TxSlot;
+
+/* En rad att skicka: ett JSON-träd, eller ett färdigserialiserat
+   data-objekt som ska in i ett game-meddelande. */
+typedef struct TxLine {
+    json_t *obj;
+    const char *game_data;
+    size_t game_len;
+    int state; /* se mp_api_game_state_text */
+} TxLine;
+
+/* Ett avkodat event. root äger allt: cmd och clientId pekar in i det. */
+typedef struct MpEvent {
+    json_t *root;
+    const char *cmd;
+    int64_t messageId;
+    const char *clientId;
+    json_t *data;
+} MpEvent;
 
 struct MultiplayerApi {
     char *server_host;
@@ -30,24 +71,108 @@ struct MultiplayerApi {
     char *app_guid;
     int sockfd;
     char *session_id;
+    char *game_prefix; /* {"session":"…","cmd":"game","data": för mp_api_game_text */
+    size_t game_prefix_len;
 
     pthread_t recv_thread;
     int recv_thread_started;
     int running;
 
     pthread_mutex_t lock;
-    ListenerNode *listeners;
+
+    /* Läses utan lås av dispatch; listen_lock serialiserar bara skrivarna */
+    _Atomic(ListenerArray *) listeners;
+    atomic_int dispatching;    /* dispatch som just nu läser en lista */
+    pthread_mutex_t listen_lock;
+    ListenerArray *retired;    /* ersatta listor som kan vara under läsning */
     int next_listener_id;
+
+    /* Får raderna före json_loadb, se mp_api_set_line_handler */
+    MultiplayerLineHandler line_handler;
+    void *line_user_data;
+
+    /* Mottagartråden producerar, spelloopen konsumerar i mp_api_dispatch */
+    MpApiDelivery delivery;
+    SpscQueue *events;
+    atomic_long dropped_events;
+
+    /* Svar på host/join/list, lämnat av den som läser från socketen */
+    pthread_cond_t reply_ready;
+    json_t *reply;
+    int reply_waiting;
+
+    /* Mottagna bytes som ännu inte blivit hela rader. Används av antingen
+       mottagartråden eller mp_api_process, aldrig av båda. Raderna tolkas
+       direkt i bufferten, så inget kopieras eller allokeras per meddelande
+       utöver själva JSON-trädet. */
+    char *rx;
+    size_t rx_start; /* första obehandlade byte */
+    size_t rx_end;   /* slutet på mottagen data */
+    size_t rx_cap;
+    atomic_long rx_messages;
+
+    /* Sammanslagning (mp_api_set_conflation): skip håller var i rx de rader
+       börjar som next_line ska hoppa över, i stigande ordning. Sätts efter
+       varje recv och är förbrukade innan nästa, så de flyttas aldrig. */
+    MultiplayerMsgClassifier classify;
+    void *classify_user_data;
+    size_t skip[MP_API_SKIP_MAX];
+    int skip_head;
+    int skip_count;
+    atomic_long rx_skipped;
+    atomic_long rx_backlogs;
+    atomic_int rx_max_backlog;
+
+    /* Sändbufferten: varje meddelande serialiseras hit, får sitt '\n' och
+       skickas med ett enda send. Återanvänds, så bara det allra första
+       (eller ett ovanligt stort) meddelandet allokerar. */
+    pthread_mutex_t send_lock;
+    TxSlot tx;
+    /* Atomiska så att mp_api_send_stats inte väntar på en blockerad send */
+    atomic_long tx_messages;
+    atomic_long tx_bytes;
+    atomic_long tx_syscalls;
+
+    /* Asynkron sändning (mp_api_set_send_queue): mp_api_game lägger
+       meddelandet i en ring av TxSlot och sändtråden skickar det. Tråden
+       byter sin egen buffert mot platsens, så inget kopieras och ingen
+       plats som håller på att skickas skrivs över. */
+    pthread_t send_thread;
+    int send_thread_started;
+    pthread_mutex_t sq_lock;
+    pthread_cond_t sq_ready;
+    MpApiSendPolicy sq_policy;
+    TxSlot *sq;
+    int sq_cap;
+    int sq_head;
+    int sq_count;
+    int sq_stopping;
+    int sq_failed;   /* sändtråden fick fel; nya meddelanden avvisas */
+    int sq_max_depth;
+    long sq_dropped;
+    long sq_coalesced;
+    long sq_rejected;
 };
 
 static int connect_to_server(const char *host, uint16_t port);
 static int ensure_connected(MultiplayerApi *api);
-static int send_all(int fd, const char *buf, size_t len);
+static int send_all(MultiplayerApi *api, const char *buf, size_t len);
 static int send_json_line(MultiplayerApi *api, json_t *obj); /* tar över ägarskap */
-static int read_line(int fd, char **out_line);
+static int send_line(MultiplayerApi *api, const TxLine *line);
+static int queue_line(MultiplayerApi *api, const TxLine *line);
+static int set_session(MultiplayerApi *api, const char *session);
+static void *send_thread_main(void *arg);
+static int read_reply(MultiplayerApi *api, json_t **out_resp);
 static void *recv_thread_main(void *arg);
-static void process_line(MultiplayerApi *api, const char *line);
+static void process_line(MultiplayerApi *api, const char *line, size_t len);
+static void hand_over_reply(MultiplayerApi *api, json_t *root);
+static void dispatch_event(MultiplayerApi *api, MpEvent *ev);
+static void free_event(MpEvent *ev);
 static int start_recv_thread(MultiplayerApi *api);
+static int start_send_thread(MultiplayerApi *api);
+static int recv_some(MultiplayerApi *api, int flags);
+static int next_line(MultiplayerApi *api, const char **out_line, size_t *out_len);
+static void conflate_lines(MultiplayerApi *api);
 
 MultiplayerApi *mp_api_create(const char *server_host, uint16_t server_port, const char *app_guid) {
     MultiplayerApi *api = (MultiplayerApi *)calloc(1, sizeof(MultiplayerApi));
@@ -75,7 +200,9 @@ MultiplayerApi *mp_api_create(const char *server_host, uint16_t server_port, con
     api->session_id = NULL;
     api->recv_thread_started = 0;
     api->running = 0;
-    api->listeners = NULL;
+    atomic_init(&api->listeners, NULL);
+    atomic_init(&api->dispatching, 0);
+    api->retired = NULL;
     api->next_listener_id = 1;
 
     if (pthread_mutex_init(&api->lock, NULL) != 0) {
@@ -83,6 +210,27 @@ MultiplayerApi *mp_api_create(const char *server_host, uint16_t server_port, con
         free(api);
         return NULL;
     }
+    if (pthread_mutex_init(&api->listen_lock, NULL) != 0) {
+        pthread_mutex_destroy(&api->lock);
+        free(api->server_host);
+        free(api);
+        return NULL;
+    }
+    if (pthread_cond_init(&api->reply_ready, NULL) != 0) {
+        pthread_mutex_destroy(&api->listen_lock);
+        pthread_mutex_destroy(&api->lock);
+        free(api->server_host);
+        free(api);
+        return NULL;
+    }
+    if (pthread_mutex_init(&api->send_lock, NULL) != 0) {
+        pthread_cond_destroy(&api->reply_ready);
+        pthread_mutex_destroy(&api->listen_lock);
+        pthread_mutex_destroy(&api->lock);
+        free(api->server_host);
+        free(api);
+        return NULL;
+    }
 
     return api;
 }
@@ -90,29 +238,55 @@ MultiplayerApi *mp_api_create(const char *server_host, uint16_t server_port, con
 void mp_api_destroy(MultiplayerApi *api) {
     if (!api) return;
 
-    if (api->recv_thread_started && api->sockfd >= 0) {
+    /* shutdown väcker både en blockerad recv och en blockerad send */
+    if ((api->recv_thread_started || api->send_thread_started) && api->sockfd >= 0) {
         shutdown(api->sockfd, SHUT_RDWR);
+    }
+    if (api->recv_thread_started) {
         pthread_join(api->recv_thread, NULL);
     }
+    if (api->send_thread_started) {
+        pthread_mutex_lock(&api->sq_lock);
+        api->sq_stopping = 1;
+        pthread_cond_signal(&api->sq_ready);
+        pthread_mutex_unlock(&api->sq_lock);
+        pthread_join(api->send_thread, NULL);
+    }
+    if (api->sq) {
+        for (int i = 0; i < api->sq_cap; i++) {
+            free(api->sq[i].buf);
+        }
+        free(api->sq);
+        pthread_cond_destroy(&api->sq_ready);
+        pthread_mutex_destroy(&api->sq_lock);
+    }
 
     if (api->sockfd >= 0) {
         close(api->sockfd);
     }
+    free(api->rx);
+    free(api->tx.buf);
 
-    pthread_mutex_lock(&api->lock);
-    ListenerNode *node = api->listeners;
-    api->listeners = NULL;
-    pthread_mutex_unlock(&api->lock);
+    if (api->events) {
+        MpEvent ev;
+        while (spsc_queue_pop(api->events, &ev)) {
+            free_event(&ev);
+        }
+        spsc_queue_destroy(api->events);
+    }
 
-    while (node) {
-        ListenerNode *next = node->next;
-        free(node);
-        node = next;
+    /* Ingen dispatch kan pågå längre: allt kan frigöras direkt */
+    free(atomic_exchange(&api->listeners, NULL));
+    while (api->retired) {
+        ListenerArray *next = api->retired->retired_next;
+        free(api->retired);
+        api->retired = next;
     }
 
     if (api->session_id) {
         free(api->session_id);
     }
+    free(api->game_prefix);
     if (api->server_host) {
         free(api->server_host);
     }
@@ -120,6 +294,13 @@ void mp_api_destroy(MultiplayerApi *api) {
         free(api->app_guid);
     }
 
+    if (api->reply) {
+        json_decref(api->reply);
+    }
+
+    pthread_mutex_destroy(&api->send_lock);
+    pthread_cond_destroy(&api->reply_ready);
+    pthread_mutex_destroy(&api->listen_lock);
     pthread_mutex_destroy(&api->lock);
     free(api);
 }
@@ -150,20 +331,12 @@ int mp_api_host(MultiplayerApi *api,
         return rc;
     }
 
-    char *line = NULL;
-    rc = read_line(api->sockfd, &line);
+    json_t *resp = NULL;
+    rc = read_reply(api, &resp);
     if (rc != MP_API_OK) {
         return rc;
     }
 
-    json_error_t jerr;
-    json_t *resp = json_loads(line, 0, &jerr);
-    free(line);
-    if (!resp || !json_is_object(resp)) {
-        if (resp) json_decref(resp);
-        return MP_API_ERR_PROTOCOL;
-    }
-
     json_t *cmd_val = json_object_get(resp, "cmd");
     if (!json_is_string(cmd_val) || strcmp(json_string_value(cmd_val), "host") != 0) {
         json_decref(resp);
@@ -187,8 +360,7 @@ int mp_api_host(MultiplayerApi *api,
         json_incref(data_obj);
     }
 
-    api->session_id = strdup(session);
-    if (!api->session_id) {
+    if (set_session(api, session) != 0) {
         if (data_obj) json_decref(data_obj);
         json_decref(resp);
         return MP_API_ERR_IO;
@@ -233,22 +405,12 @@ int mp_api_list(MultiplayerApi *api, json_t **out_list)
 		return rc;
 	}
 
-	char *line = NULL;
-	rc = read_line(api->sockfd, &line);
+	json_t *resp = NULL;
+	rc = read_reply(api, &resp);
 	if (rc != MP_API_OK) {
 		return rc;
 	}
 
-	printf("Received line: %s\n", line); // Debug print
-
-	json_error_t jerr;
-	json_t *resp = json_loads(line, 0, &jerr);
-	free(line);
-	if (!resp || !json_is_object(resp)) {
-		if (resp) json_decref(resp);
-		return MP_API_ERR_PROTOCOL;
-	}
-
 	json_t *cmd_val = json_object_get(resp, "cmd");
 	if (!json_is_string(cmd_val) || strcmp(json_string_value(cmd_val), "list") != 0) {
 		json_decref(resp);
@@ -309,20 +471,12 @@ int mp_api_join(MultiplayerApi *api,
         return rc;
     }
 
-    char *line = NULL;
-    rc = read_line(api->sockfd, &line);
+    json_t *resp = NULL;
+    rc = read_reply(api, &resp);
     if (rc != MP_API_OK) {
         return rc;
     }
 
-    json_error_t jerr;
-    json_t *resp = json_loads(line, 0, &jerr);
-    free(line);
-    if (!resp || !json_is_object(resp)) {
-        if (resp) json_decref(resp);
-        return MP_API_ERR_PROTOCOL;
-    }
-
     json_t *cmd_val = json_object_get(resp, "cmd");
     if (!json_is_string(cmd_val) || strcmp(json_string_value(cmd_val), "join") != 0) {
         json_decref(resp);
@@ -355,8 +509,7 @@ int mp_api_join(MultiplayerApi *api,
     }
 
     if (joinAccepted && session) {
-        api->session_id = strdup(session);
-        if (!api->session_id) {
+        if (set_session(api, session) != 0) {
             if (data_obj) json_decref(data_obj);
             json_decref(resp);
             return MP_API_ERR_IO;
@@ -400,7 +553,255 @@ int mp_api_game(MultiplayerApi *api, json_t *data) {
     json_incref(data); 
     json_object_set_new(root, "data", data);
 
-    return send_json_line(api, root);
+    TxLine line = { root, NULL, 0 };
+    int rc = api->sq ? queue_line(api, &line) : send_line(api, &line);
+    json_decref(root);
+    return rc;
+}
+
+int mp_api_game_text(MultiplayerApi *api, const char *data, size_t len) {
+    if (!api || !data || len == 0) return MP_API_ERR_ARGUMENT;
+    if (api->sockfd < 0 || !api->game_prefix) return MP_API_ERR_STATE;
+
+    TxLine line = { NULL, data, len, 0 };
+    return api->sq ? queue_line(api, &line) : send_line(api, &line);
+}
+
+int mp_api_game_state_text(MultiplayerApi *api, const char *data, size_t len) {
+    if (!api || !data || len == 0) return MP_API_ERR_ARGUMENT;
+    if (api->sockfd < 0 || !api->game_prefix) return MP_API_ERR_STATE;
+
+    TxLine line = { NULL, data, len, 1 };
+    return api->sq ? queue_line(api, &line) : send_line(api, &line);
+}
+
+int mp_api_set_send_queue(MultiplayerApi *api, int capacity, MpApiSendPolicy policy) {
+    if (!api || capacity < 1) return MP_API_ERR_ARGUMENT;
+    if (policy != MP_API_SEND_DROP_OLDEST && policy != MP_API_SEND_COALESCE) return MP_API_ERR_ARGUMENT;
+    if (api->sq) return MP_API_ERR_STATE;
+
+    TxSlot *slots = (TxSlot *)calloc((size_t)capacity, sizeof(TxSlot));
+    if (!slots) return MP_API_ERR_IO;
+
+    if (pthread_mutex_init(&api->sq_lock, NULL) != 0) {
+        free(slots);
+        return MP_API_ERR_IO;
+    }
+    if (pthread_cond_init(&api->sq_ready, NULL) != 0) {
+        pthread_mutex_destroy(&api->sq_lock);
+        free(slots);
+        return MP_API_ERR_IO;
+    }
+
+    api->sq = slots;
+    api->sq_cap = capacity;
+    api->sq_policy = policy;
+
+    if (start_send_thread(api) != MP_API_OK) {
+        pthread_cond_destroy(&api->sq_ready);
+        pthread_mutex_destroy(&api->sq_lock);
+        free(slots);
+        api->sq = NULL;
+        return MP_API_ERR_IO;
+    }
+    return MP_API_OK;
+}
+
+int mp_api_set_delivery(MultiplayerApi *api, MpApiDelivery mode) {
+    if (!api) return MP_API_ERR_ARGUMENT;
+    if (mode != MP_API_DELIVER_THREAD && mode != MP_API_DELIVER_QUEUED &&
+        mode != MP_API_DELIVER_PUMP) return MP_API_ERR_ARGUMENT;
+    if (api->recv_thread_started) return MP_API_ERR_STATE;
+
+    if (mode == MP_API_DELIVER_QUEUED && !api->events) {
+        api->events = spsc_queue_create(MP_API_EVENT_QUEUE, sizeof(MpEvent));
+        if (!api->events) return MP_API_ERR_IO;
+    }
+
+    api->delivery = mode;
+    return MP_API_OK;
+}
+
+int mp_api_set_line_handler(MultiplayerApi *api,
+                            MultiplayerLineHandler handler,
+                            void *user_data) {
+    if (!api) return MP_API_ERR_ARGUMENT;
+    if (api->recv_thread_started) return MP_API_ERR_STATE;
+
+    api->line_handler = handler;
+    api->line_user_data = user_data;
+    return MP_API_OK;
+}
+
+int mp_api_set_conflation(MultiplayerApi *api,
+                          MultiplayerMsgClassifier classify,
+                          void *user_data) {
+    if (!api) return MP_API_ERR_ARGUMENT;
+    if (api->recv_thread_started) return MP_API_ERR_STATE;
+
+    api->classify = classify;
+    api->classify_user_data = user_data;
+    return MP_API_OK;
+}
+
+void mp_api_deliver(MultiplayerApi *api,
+                    const char *event,
+                    int64_t messageId,
+                    const char *clientId,
+                    json_t *data) {
+    if (!api || !event) return;
+
+    if (data) json_incref(data);
+    else data = json_object();
+
+    MpEvent ev = { NULL, event, messageId, clientId, data };
+    dispatch_event(api, &ev);
+}
+
+int mp_api_dispatch(MultiplayerApi *api, int max_events) {
+    if (!api || !api->events) return 0;
+
+    int n = 0;
+    MpEvent ev;
+    while ((max_events <= 0 || n < max_events) && spsc_queue_pop(api->events, &ev)) {
+        dispatch_event(api, &ev);
+        n++;
+    }
+    return n;
+}
+
+long mp_api_dropped_events(MultiplayerApi *api) {
+    return api ? atomic_load(&api->dropped_events) : 0;
+}
+
+int mp_api_fd(MultiplayerApi *api) {
+    return api ? api->sockfd : -1;
+}
+
+void mp_api_disconnect(MultiplayerApi *api) {
+    if (!api || api->sockfd < 0) return;
+
+    /* shutdown väcker trådarna, som sedan tas ner; nästa host/join startar dem igen */
+    shutdown(api->sockfd, SHUT_RDWR);
+    if (api->recv_thread_started) {
+        pthread_join(api->recv_thread, NULL);
+        api->recv_thread_started = 0;
+        api->running = 0;
+    }
+    if (api->send_thread_started) {
+        pthread_mutex_lock(&api->sq_lock);
+        api->sq_stopping = 1;
+        pthread_cond_signal(&api->sq_ready);
+        pthread_mutex_unlock(&api->sq_lock);
+        pthread_join(api->send_thread, NULL);
+        api->send_thread_started = 0;
+
+        /* Det som väntade var adresserat till den gamla sessionen */
+        pthread_mutex_lock(&api->sq_lock);
+        api->sq_head = 0;
+        api->sq_count = 0;
+        pthread_mutex_unlock(&api->sq_lock);
+    }
+
+    pthread_mutex_lock(&api->send_lock);
+    close(api->sockfd);
+    api->sockfd = -1;
+    pthread_mutex_unlock(&api->send_lock);
+
+    free(api->session_id);
+    api->session_id = NULL;
+    free(api->game_prefix);
+    api->game_prefix = NULL;
+    api->game_prefix_len = 0;
+
+    api->rx_start = 0;
+    api->rx_end = 0;
+    api->skip_head = 0;
+    api->skip_count = 0;
+    if (api->reply) {
+        json_decref(api->reply);
+        api->reply = NULL;
+    }
+}
+
+int mp_api_process(MultiplayerApi *api, int budget) {
+    if (!api) return -1;
+    if (api->sockfd < 0 || api->delivery != MP_API_DELIVER_PUMP) return -1;
+
+    int handled = 0;
+    int closed = 0;
+    for (;;) {
+        const char *line;
+        size_t len;
+        while ((budget <= 0 || handled < budget) && next_line(api, &line, &len)) {
+            process_line(api, line, len);
+            handled++;
+        }
+        if (budget > 0 && handled >= budget) break;
+
+        int n = recv_some(api, MSG_DONTWAIT);
+        if (n == 0) break;          /* inget mer just nu */
+        if (n < 0) {
+            closed = 1;
+            break;
+        }
+    }
+
+    /* Allt som hann komma är levererat; stäng först när inget återstår */
+    if (closed && handled == 0) {
+        mp_api_disconnect(api);
+        return -1;
+    }
+    return handled;
+}
+
+void mp_api_recv_stats(MultiplayerApi *api, MpApiRecvStats *out) {
+    if (!api || !out) return;
+
+    out->messages = atomic_load(&api->rx_messages);
+    out->skipped = atomic_load(&api->rx_skipped);
+    out->backlogs = atomic_load(&api->rx_backlogs);
+    out->max_backlog = atomic_load(&api->rx_max_backlog);
+}
+
+void mp_api_send_stats(MultiplayerApi *api, MpApiSendStats *out) {
+    if (!api || !out) return;
+
+    memset(out, 0, sizeof(*out));
+    out->messages = atomic_load(&api->tx_messages);
+    out->bytes = atomic_load(&api->tx_bytes);
+    out->syscalls = atomic_load(&api->tx_syscalls);
+
+    if (api->sq) {
+        pthread_mutex_lock(&api->sq_lock);
+        out->queued = api->sq_count;
+        out->max_queued = api->sq_max_depth;
+        out->dropped = api->sq_dropped;
+        out->coalesced = api->sq_coalesced;
+        out->rejected = api->sq_rejected;
+        pthread_mutex_unlock(&api->sq_lock);
+    }
+}
+
+/* Lägger old bland de ersatta listorna och frigör alla ersatta listor om
+   ingen dispatch pågår. Bytet av pekaren och läsningen av dispatching är
+   båda seq_cst: ser vi noll här kan en dispatch som börjar senare bara se
+   den nya listan. Anropas med listen_lock. Pågår en dispatch (t.ex. en
+   lyssnare som avregistrerar sig själv) skjuts frigörandet upp till nästa
+   ändring, eller till mp_api_destroy. */
+static void retire_listeners(MultiplayerApi *api, ListenerArray *old) {
+    if (old) {
+        old->retired_next = api->retired;
+        api->retired = old;
+    }
+
+    if (atomic_load(&api->dispatching) != 0) return;
+
+    while (api->retired) {
+        ListenerArray *next = api->retired->retired_next;
+        free(api->retired);
+        api->retired = next;
+    }
 }
 
 int mp_api_listen(MultiplayerApi *api,
@@ -408,41 +809,66 @@ int mp_api_listen(MultiplayerApi *api,
                   void *user_data) {
     if (!api || !cb) return -1;
 
-    ListenerNode *node = (ListenerNode *)malloc(sizeof(ListenerNode));
-    if (!node) return -1;
+    pthread_mutex_lock(&api->listen_lock);
+    ListenerArray *old = atomic_load(&api->listeners);
+    int old_count = old ? old->count : 0;
 
-    node->cb = cb;
-    node->user_data = user_data;
+    ListenerArray *arr = (ListenerArray *)malloc(sizeof(ListenerArray) + sizeof(ListenerEntry) * (old_count + 1));
+    if (!arr) {
+        pthread_mutex_unlock(&api->listen_lock);
+        return -1;
+    }
 
-    pthread_mutex_lock(&api->lock);
-    node->id = api->next_listener_id++;
-    node->next = api->listeners;
-    api->listeners = node;
-    pthread_mutex_unlock(&api->lock);
+    int id = api->next_listener_id++;
+    arr->retired_next = NULL;
+    arr->count = old_count + 1;
+    arr->items[0].id = id;
+    arr->items[0].cb = cb;
+    arr->items[0].user_data = user_data;
+    if (old_count > 0) {
+        memcpy(&arr->items[1], old->items, sizeof(ListenerEntry) * old_count);
+    }
+
+    atomic_store(&api->listeners, arr);
+    retire_listeners(api, old);
+    pthread_mutex_unlock(&api->listen_lock);
 
-    return node->id;
+    return id;
 }
 
 void mp_api_unlisten(MultiplayerApi *api, int listener_id) {
     if (!api || listener_id <= 0) return;
 
-    pthread_mutex_lock(&api->lock);
-    ListenerNode *prev = NULL;
-    ListenerNode *cur = api->listeners;
-    while (cur) {
-        if (cur->id == listener_id) {
-            if (prev) {
-                prev->next = cur->next;
-            } else {
-                api->listeners = cur->next;
-            }
-            free(cur);
+    pthread_mutex_lock(&api->listen_lock);
+    ListenerArray *old = atomic_load(&api->listeners);
+    int at = -1;
+    for (int i = 0; old && i < old->count; i++) {
+        if (old->items[i].id == listener_id) {
+            at = i;
             break;
         }
-        prev = cur;
-        cur = cur->next;
     }
-    pthread_mutex_unlock(&api->lock);
+    if (at < 0) {
+        pthread_mutex_unlock(&api->listen_lock);
+        return;
+    }
+
+    ListenerArray *arr = NULL;
+    if (old->count > 1) {
+        arr = (ListenerArray *)malloc(sizeof(ListenerArray) + sizeof(ListenerEntry) * (old->count - 1));
+        if (!arr) {
+            pthread_mutex_unlock(&api->listen_lock);
+            return;
+        }
+        arr->retired_next = NULL;
+        arr->count = old->count - 1;
+        memcpy(arr->items, old->items, sizeof(ListenerEntry) * at);
+        memcpy(&arr->items[at], &old->items[at + 1], sizeof(ListenerEntry) * (old->count - at - 1));
+    }
+
+    atomic_store(&api->listeners, arr);
+    retire_listeners(api, old);
+    pthread_mutex_unlock(&api->listen_lock);
 }
 
 /* --- Interna hjälpfunktioner --- */
@@ -469,6 +895,9 @@ static int connect_to_server(const char *host, uint16_t port) {
         fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
         if (fd == -1) continue;
         if (connect(fd, rp->ai_addr, rp->ai_addrlen) == 0) {
+            /* Små speluppdateringar ska iväg direkt, inte vänta på Nagle */
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
             break;
         }
         close(fd);
@@ -488,13 +917,22 @@ static int ensure_connected(MultiplayerApi *api) {
         return MP_API_ERR_CONNECT;
     }
     api->sockfd = fd;
+
+    /* Sändtråden togs ner av mp_api_disconnect */
+    if (api->sq && !api->send_thread_started && start_send_thread(api) != MP_API_OK) {
+        close(fd);
+        api->sockfd = -1;
+        return MP_API_ERR_IO;
+    }
     return MP_API_OK;
 }
 
-static int send_all(int fd, const char *buf, size_t len) {
+/* Räknar varje send i tx_syscalls/tx_bytes. Anropas med send_lock. */
+static int send_all(MultiplayerApi *api, const char *buf, size_t len) {
     size_t sent = 0;
     while (sent < len) {
-        ssize_t n = send(fd, buf + sent, len - sent, 0);
+        ssize_t n = send(api->sockfd, buf + sent, len - sent, MSG_NOSIGNAL);
+        atomic_fetch_add(&api->tx_syscalls, 1);
         if (n < 0) {
             if (errno == EINTR) continue;
             return -1;
@@ -503,83 +941,265 @@ static int send_all(int fd, const char *buf, size_t len) {
             return -1;
         }
         sent += (size_t)n;
+        atomic_fetch_add(&api->tx_bytes, n);
     }
     return 0;
 }
 
+/* Ser till att slot har plats för need bytes till. */
+static int slot_reserve(TxSlot *slot, size_t need) {
+    if (slot->cap - slot->len >= need) return 0;
+
+    size_t cap = slot->cap ? slot->cap : MP_API_TX_SIZE;
+    while (cap - slot->len < need) cap *= 2;
+
+    char *tmp = (char *)realloc(slot->buf, cap);
+    if (!tmp) return -1;
+    slot->buf = tmp;
+    slot->cap = cap;
+    return 0;
+}
+
+static int slot_append(const char *buffer, size_t size, void *data) {
+    TxSlot *slot = (TxSlot *)data;
+    if (slot_reserve(slot, size) != 0) return -1;
+    memcpy(slot->buf + slot->len, buffer, size);
+    slot->len += size;
+    return 0;
+}
+
+/* json_dump_callback skriver rakt in i bufferten i stället för via
+   json_dumps egen strbuffer och en strdup. */
+static int slot_serialize(TxSlot *slot, json_t *obj) {
+    slot->len = 0;
+    if (json_dump_callback(obj, slot_append, slot, JSON_COMPACT) != 0) return -1;
+    return slot_append("\n", 1, slot);
+}
+
+/* Serialiserar line till slot, med '\n'. Ett färdigt data-objekt kopieras
+   bara in mellan game_prefix och "}", så det allokerar ingenting när
+   platsen redan är stor nog. */
+static int slot_fill(MultiplayerApi *api, TxSlot *slot, const TxLine *line) {
+    slot->state = line->state;
+    if (line->obj) return slot_serialize(slot, line->obj);
+
+    slot->len = 0;
+    if (slot_append(api->game_prefix, api->game_prefix_len, slot) != 0 ||
+        slot_append(line->game_data, line->game_len, slot) != 0 ||
+        slot_append("}\n", 2, slot) != 0) return -1;
+    return 0;
+}
+
+static int send_line(MultiplayerApi *api, const TxLine *line) {
+    pthread_mutex_lock(&api->send_lock);
+
+    int rc = 0;
+    if (slot_fill(api, &api->tx, line) != 0) {
+        rc = MP_API_ERR_IO;
+    } else if (send_all(api, api->tx.buf, api->tx.len) != 0) {
+        rc = MP_API_ERR_IO;
+    } else {
+        atomic_fetch_add(&api->tx_messages, 1);
+    }
+    pthread_mutex_unlock(&api->send_lock);
+
+    return rc;
+}
+
 static int send_json_line(MultiplayerApi *api, json_t *obj) {
     if (!api || api->sockfd < 0 || !obj) return MP_API_ERR_ARGUMENT;
 
-    char *text = json_dumps(obj, JSON_COMPACT);
-    if (!text) {
-        json_decref(obj);
+    TxLine line = { obj, NULL, 0 };
+    int rc = send_line(api, &line);
+    json_decref(obj);
+
+    return rc;
+}
+
+/* Lägger meddelandet sist i sändkön utan att vänta på socketen. Är kön
+   full bestämmer sq_policy: släng det äldsta, eller skriv över det senast
+   köade om både det och det nya är hela tillstånd. En ändring eller
+   förfrågan skrivs aldrig över; då avvisas det nya med MP_API_ERR_FULL så
+   att anroparen vet att något inte kom fram. */
+static int queue_line(MultiplayerApi *api, const TxLine *line) {
+    pthread_mutex_lock(&api->sq_lock);
+    if (api->sq_failed) {
+        pthread_mutex_unlock(&api->sq_lock);
         return MP_API_ERR_IO;
     }
 
-    size_t len = strlen(text);
-    int fd = api->sockfd;
+    if (api->sq_count == api->sq_cap) {
+        if (api->sq_policy == MP_API_SEND_COALESCE) {
+            const TxSlot *newest = &api->sq[(api->sq_head + api->sq_count - 1) % api->sq_cap];
+            if (!newest->state || !line->state) {
+                api->sq_rejected++;
+                pthread_mutex_unlock(&api->sq_lock);
+                return MP_API_ERR_FULL;
+            }
+            api->sq_count--; /* platsen återanvänds nedan */
+            api->sq_coalesced++;
+        } else {
+            api->sq_head = (api->sq_head + 1) % api->sq_cap;
+            api->sq_count--;
+            api->sq_dropped++;
+        }
+    }
 
-    int rc = 0;
-    if (send_all(fd, text, len) != 0 || send_all(fd, "\n", 1) != 0) {
+    TxSlot *slot = &api->sq[(api->sq_head + api->sq_count) % api->sq_cap];
+    int rc = MP_API_OK;
+    if (slot_fill(api, slot, line) != 0) {
         rc = MP_API_ERR_IO;
+    } else {
+        api->sq_count++;
+        if (api->sq_count > api->sq_max_depth) api->sq_max_depth = api->sq_count;
+        pthread_cond_signal(&api->sq_ready);
     }
-
-    free(text);
-    json_decref(obj);
+    pthread_mutex_unlock(&api->sq_lock);
 
     return rc;
 }
 
-static int read_line(int fd, char **out_line) {
-    if (!out_line) return MP_API_ERR_ARGUMENT;
+/* Sparar sessions-ID:t och bygger början på varje game-meddelande en gång,
+   med ID:t JSON-kodat av jansson. */
+static int set_session(MultiplayerApi *api, const char *session) {
+    json_t *sid = json_string(session);
+    char *quoted = sid ? json_dumps(sid, JSON_ENCODE_ANY) : NULL;
+    json_decref(sid);
+    if (!quoted) return -1;
+
+    size_t cap = strlen(quoted) + 64;
+    char *prefix = (char *)malloc(cap);
+    char *copy = strdup(session);
+    if (!prefix || !copy) {
+        free(prefix);
+        free(copy);
+        free(quoted);
+        return -1;
+    }
+    snprintf(prefix, cap, "{\"session\":%s,\"cmd\":\"game\",\"data\":", quoted);
+    free(quoted);
 
-    size_t cap = 256;
-    size_t len = 0;
-    char *buf = (char *)malloc(cap);
-    if (!buf) return MP_API_ERR_IO;
+    free(api->game_prefix);
+    api->game_prefix = prefix;
+    api->game_prefix_len = strlen(prefix);
+    api->session_id = copy;
+    return 0;
+}
 
+/* Tömmer sändkön. Blockerar send här gör bara att kön fylls på. */
+static void *send_thread_main(void *arg) {
+    MultiplayerApi *api = (MultiplayerApi *)arg;
+    TxSlot out = { NULL, 0, 0 };
+
+    pthread_mutex_lock(&api->sq_lock);
     for (;;) {
-        char c;
-        ssize_t n = recv(fd, &c, 1, 0);
-        if (n < 0) {
-            if (errno == EINTR) continue;
-            free(buf);
-            return MP_API_ERR_IO;
+        while (api->sq_count == 0 && !api->sq_stopping) {
+            pthread_cond_wait(&api->sq_ready, &api->sq_lock);
         }
-        if (n == 0) {
-            free(buf);
-            return MP_API_ERR_IO;
-        }
-
-        if (c == '\n') {
+        if (api->sq_stopping) break;
+
+        /* Byt buffert med platsen i stället för att kopiera */
+        TxSlot tmp = api->sq[api->sq_head];
+        api->sq[api->sq_head] = out;
+        out = tmp;
+        api->sq_head = (api->sq_head + 1) % api->sq_cap;
+        api->sq_count--;
+        pthread_mutex_unlock(&api->sq_lock);
+
+        pthread_mutex_lock(&api->send_lock);
+        int rc = send_all(api, out.buf, out.len);
+        if (rc == 0) atomic_fetch_add(&api->tx_messages, 1);
+        pthread_mutex_unlock(&api->send_lock);
+
+        pthread_mutex_lock(&api->sq_lock);
+        if (rc != 0) {
+            api->sq_failed = 1;
             break;
         }
+    }
+    pthread_mutex_unlock(&api->sq_lock);
 
-        if (len + 1 >= cap) {
-            cap *= 2;
-            char *tmp = (char *)realloc(buf, cap);
-            if (!tmp) {
-                free(buf);
-                return MP_API_ERR_IO;
-            }
-            buf = tmp;
+    free(out.buf);
+    return NULL;
+}
+
+/* Väntar på svaret på en host/join/list-förfrågan. Svaret läses ur samma
+   buffert som mottagaren använder, så inga bytes går förlorade vid
+   överlämningen och events som kommer före svaret levereras som vanligt.
+   Med mottagartråd igång är det tråden som läser och lämnar över svaret. */
+static int read_reply(MultiplayerApi *api, json_t **out_resp) {
+    if (!api || !out_resp) return MP_API_ERR_ARGUMENT;
+
+    pthread_mutex_lock(&api->lock);
+    if (api->reply) {
+        json_decref(api->reply); /* svar som ingen väntade på */
+        api->reply = NULL;
+    }
+    api->reply_waiting = 1;
+
+    if (api->recv_thread_started) {
+        while (!api->reply && api->running) {
+            pthread_cond_wait(&api->reply_ready, &api->lock);
         }
+    } else {
+        while (!api->reply) {
+            pthread_mutex_unlock(&api->lock);
+
+            const char *line;
+            size_t len;
+            int ok = 1;
+            if (next_line(api, &line, &len)) {
+                process_line(api, line, len);
+            } else {
+                ok = recv_some(api, 0) > 0;
+            }
 
-        buf[len++] = c;
+            pthread_mutex_lock(&api->lock);
+            if (!ok) break;
+        }
     }
 
-    buf[len] = '\0';
-    *out_line = buf;
+    json_t *resp = api->reply;
+    api->reply = NULL;
+    api->reply_waiting = 0;
+    pthread_mutex_unlock(&api->lock);
+
+    if (!resp) return MP_API_ERR_IO;
+    if (!json_is_object(resp)) {
+        json_decref(resp);
+        return MP_API_ERR_PROTOCOL;
+    }
+    *out_resp = resp;
     return MP_API_OK;
 }
 
-static void process_line(MultiplayerApi *api, const char *line) {
-    if (!api || !line || !*line) return;
+/* Lämnar ett svar till read_reply; tar över ägarskapet av root. */
+static void hand_over_reply(MultiplayerApi *api, json_t *root) {
+    pthread_mutex_lock(&api->lock);
+    if (api->reply_waiting && !api->reply) {
+        api->reply = root;
+        root = NULL;
+        pthread_cond_signal(&api->reply_ready);
+    }
+    pthread_mutex_unlock(&api->lock);
+
+    if (root) json_decref(root);
+}
+
+static void process_line(MultiplayerApi *api, const char *line, size_t len) {
+    if (!api || !line || len == 0) return;
+
+    if (api->line_handler && api->delivery != MP_API_DELIVER_QUEUED &&
+        api->line_handler(line, len, api->line_user_data)) {
+        return;
+    }
 
     json_error_t jerr;
-    json_t *root = json_loads(line, 0, &jerr);
+    json_t *root = json_loadb(line, len, 0, &jerr);
     if (!root || !json_is_object(root)) {
         if (root) json_decref(root);
+        /* Trasig rad medan någon väntar på svar: låt förfrågan misslyckas */
+        hand_over_reply(api, json_null());
         return;
     }
 
@@ -595,6 +1215,13 @@ static void process_line(MultiplayerApi *api, const char *line) {
         return;
     }
 
+    if (strcmp(cmd, "host") == 0 ||
+        strcmp(cmd, "join") == 0 ||
+        strcmp(cmd, "list") == 0) {
+        hand_over_reply(api, root);
+        return;
+    }
+
     if (strcmp(cmd, "joined") != 0 &&
         strcmp(cmd, "leaved") != 0 &&
         strcmp(cmd, "game") != 0) {
@@ -623,112 +1250,336 @@ static void process_line(MultiplayerApi *api, const char *line) {
         data_obj = json_object();
     }
 
-    pthread_mutex_lock(&api->lock);
-    int count = 0;
-    ListenerNode *node = api->listeners;
-    while (node) {
-        if (node->cb) count++;
-        node = node->next;
-    }
+    MpEvent ev = { root, cmd, (int64_t)msgId, clientId, data_obj };
 
-    if (count == 0) {
-        pthread_mutex_unlock(&api->lock);
-        json_decref(data_obj);
-        json_decref(root);
+    if (api->delivery == MP_API_DELIVER_QUEUED) {
+        /* Full kö: släpp det nya eventet hellre än att blockera mottagningen */
+        if (!spsc_queue_push(api->events, &ev)) {
+            atomic_fetch_add(&api->dropped_events, 1);
+            free_event(&ev);
+        }
         return;
     }
 
-    ListenerSnapshot *snapshot = (ListenerSnapshot *)malloc(sizeof(ListenerSnapshot) * count);
-    if (!snapshot) {
-        pthread_mutex_unlock(&api->lock);
-        json_decref(data_obj);
-        json_decref(root);
-        return;
+    dispatch_event(api, &ev);
+}
+
+static void free_event(MpEvent *ev) {
+    json_decref(ev->data);
+    json_decref(ev->root);
+}
+
+/* Kör alla lyssnare för eventet och frigör det. Varken lås eller malloc:
+   listan som läses ändras aldrig och frigörs inte medan vi är här. */
+static void dispatch_event(MultiplayerApi *api, MpEvent *ev) {
+    atomic_fetch_add(&api->dispatching, 1);
+    const ListenerArray *arr = atomic_load(&api->listeners);
+
+    if (arr) {
+        for (int i = 0; i < arr->count; ++i) {
+            const ListenerEntry *l = &arr->items[i];
+            l->cb(ev->cmd, ev->messageId, ev->clientId, ev->data, l->user_data);
+        }
+    }
+
+    atomic_fetch_sub(&api->dispatching, 1);
+    free_event(ev);
+}
+
+/* En recv in i rx. Returnerar antal lästa bytes, 0 om inget finns att läsa
+   just nu (MSG_DONTWAIT) och -1 när anslutningen stängts eller fel uppstått. */
+static int recv_some(MultiplayerApi *api, int flags) {
+    if (!api->rx) {
+        api->rx = (char *)malloc(MP_API_RX_SIZE);
+        if (!api->rx) return -1;
+        api->rx_cap = MP_API_RX_SIZE;
     }
 
-    int idx = 0;
-    node = api->listeners;
-    while (node) {
-        if (node->cb) {
-            snapshot[idx].cb = node->cb;
-            snapshot[idx].user_data = node->user_data;
-            idx++;
+    /* Ont om plats i slutet: flytta ner den påbörjade raden (oftast bara
+       några bytes) till början. Räcker inte det är raden längre än
+       bufferten och den får växa. */
+    if (api->rx_cap - api->rx_end < MP_API_RX_MIN_READ) {
+        size_t pending = api->rx_end - api->rx_start;
+        memmove(api->rx, api->rx + api->rx_start, pending);
+        api->rx_start = 0;
+        api->rx_end = pending;
+
+        if (api->rx_cap - api->rx_end < MP_API_RX_MIN_READ) {
+            char *tmp = (char *)realloc(api->rx, api->rx_cap * 2);
+            if (!tmp) return -1;
+            api->rx = tmp;
+            api->rx_cap *= 2;
         }
-        node = node->next;
     }
-    pthread_mutex_unlock(&api->lock);
 
-    for (int i = 0; i < count; ++i) {
-        snapshot[i].cb(cmd, (int64_t)msgId, clientId, data_obj, snapshot[i].user_data);
+    for (;;) {
+        ssize_t n = recv(api->sockfd, api->rx + api->rx_end, api->rx_cap - api->rx_end, flags);
+        if (n > 0) {
+            api->rx_end += (size_t)n;
+            conflate_lines(api);
+            return (int)n;
+        }
+        if (n == 0) return -1;
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        return -1;
     }
+}
 
-    free(snapshot);
-    json_decref(data_obj);
-    json_decref(root);
+/* Nästa hela rad i rx (utan '\n'), som pekare rakt in i bufferten. Den är
+   giltig tills nästa recv_some. Tomma rader hoppas över. Returnerar 1 om
+   en rad fanns. */
+static int next_line(MultiplayerApi *api, const char **out_line, size_t *out_len) {
+    while (api->rx_start < api->rx_end) {
+        const char *begin = api->rx + api->rx_start;
+        const char *nl = (const char *)memchr(begin, '\n', api->rx_end - api->rx_start);
+        if (!nl) break;
+
+        size_t len = (size_t)(nl - begin);
+        size_t at = api->rx_start;
+        api->rx_start += len + 1;
+        if (len == 0) continue;
+
+        atomic_fetch_add(&api->rx_messages, 1);
+        if (api->skip_head < api->skip_count && api->skip[api->skip_head] == at) {
+            api->skip_head++;
+            atomic_fetch_add(&api->rx_skipped, 1);
+            continue;
+        }
+
+        *out_line = begin;
+        *out_len = len;
+        return 1;
+    }
+
+    /* Allt behandlat: nästa recv kan börja från början igen */
+    if (api->rx_start == api->rx_end) {
+        api->rx_start = 0;
+        api->rx_end = 0;
+    }
+    return 0;
 }
 
-static void *recv_thread_main(void *arg) {
-    MultiplayerApi *api = (MultiplayerApi *)arg;
-    char buffer[1024];
-    char *acc = NULL;
-    size_t acc_len = 0;
-    size_t acc_cap = 0;
-
-    while (1) {
-        ssize_t n = recv(api->sockfd, buffer, sizeof(buffer), 0);
-        if (n <= 0) {
-            break;
+/* --- Sammanslagning av väntande rader --- */
+
+typedef struct {
+    const char *p;
+    size_t len;
+} Span;
+
+static int span_is(Span s, const char *lit) {
+    size_t n = strlen(lit);
+    return s.len == n && memcmp(s.p, lit, n) == 0;
+}
+
+static const char *skip_ws(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p;
+}
+
+/* p står på '"'. Returnerar pekaren efter slutcitattecknet, eller NULL. */
+static const char *skip_string(const char *p, const char *end) {
+    for (p++; p < end; p++) {
+        if (*p == '\\') {
+            if (++p >= end) return NULL;
+        } else if (*p == '"') {
+            return p + 1;
         }
+    }
+    return NULL;
+}
 
-        for (ssize_t i = 0; i < n; ++i) {
-            char ch = buffer[i];
-            if (ch == '\n') {
-                if (acc_len > 0) {
-                    char *line = (char *)malloc(acc_len + 1);
-                    if (!line) {
-                        acc_len = 0;
-                        continue;
-                    }
-                    memcpy(line, acc, acc_len);
-                    line[acc_len] = '\0';
-
-                    acc_len = 0;
-                    process_line(api, line);
-                    free(line);
-                } else {
-                    acc_len = 0;
-                }
-            } else {
-                if (acc_len + 1 >= acc_cap) {
-                    size_t new_cap = acc_cap == 0 ? 256 : acc_cap * 2;
-                    char *tmp = (char *)realloc(acc, new_cap);
-                    if (!tmp) {
-                        free(acc);
-                        acc = NULL;
-                        acc_len = 0;
-                        acc_cap = 0;
-                        break;
-                    }
-                    acc = tmp;
-                    acc_cap = new_cap;
-                }
-                acc[acc_len++] = ch;
+/* Hoppar över ett helt JSON-värde utan att tolka det. Returnerar pekaren
+   efter värdet, eller NULL om raden tar slut för tidigt. */
+static const char *skip_value(const char *p, const char *end) {
+    if (p >= end) return NULL;
+    if (*p == '"') return skip_string(p, end);
+
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (p < end) {
+            if (*p == '"') {
+                p = skip_string(p, end);
+                if (!p) return NULL;
+                continue;
+            }
+            if (*p == '{' || *p == '[') {
+                depth++;
+            } else if (*p == '}' || *p == ']') {
+                if (--depth == 0) return p + 1;
             }
+            p++;
         }
+        return NULL;
     }
 
-    if (acc) {
-        free(acc);
+    const char *start = p;
+    while (p < end && *p != ',' && *p != '}' && *p != ']' &&
+           *p != ' ' && *p != '\t' && *p != '\r') p++;
+    return p > start ? p : NULL;
+}
+
+/* Hittar cmd och clientId (utan citattecken) och data i radens yttersta
+   objekt; resten hoppas bara över. Det som saknas eller inte är en sträng
+   blir en tom Span. Returnerar 0 om raden inte är ett helt objekt. */
+static int scan_envelope(const char *p, size_t len, Span *cmd, Span *client, Span *data) {
+    const char *end = p + len;
+    memset(cmd, 0, sizeof(*cmd));
+    memset(client, 0, sizeof(*client));
+    memset(data, 0, sizeof(*data));
+
+    p = skip_ws(p, end);
+    if (p >= end || *p != '{') return 0;
+    p = skip_ws(p + 1, end);
+    if (p < end && *p == '}') return 1;
+
+    for (;;) {
+        if (p >= end || *p != '"') return 0;
+        const char *key = p + 1;
+        p = skip_string(p, end);
+        if (!p) return 0;
+        Span k = { key, (size_t)(p - 1 - key) };
+
+        p = skip_ws(p, end);
+        if (p >= end || *p != ':') return 0;
+        const char *value = skip_ws(p + 1, end);
+        p = skip_value(value, end);
+        if (!p) return 0;
+        Span v = { value, (size_t)(p - value) };
+        Span str = { value + 1, v.len - 2 }; /* giltig bara om *value == '"' */
+
+        if (span_is(k, "cmd") && *value == '"') *cmd = str;
+        else if (span_is(k, "clientId") && *value == '"') *client = str;
+        else if (span_is(k, "data")) *data = v;
+
+        p = skip_ws(p, end);
+        if (p < end && *p == ',') {
+            p = skip_ws(p + 1, end);
+            continue;
+        }
+        return p < end && *p == '}';
+    }
+}
+
+/* Direkt efter en recv: väntar flera hela rader markeras de game-rader som
+   en senare ögonblicksbild från samma clientId gör överflödiga. Raderna gås
+   igenom bakifrån; en avsändare är "ersatt" från dess senaste
+   ögonblicksbild och bakåt fram till en joined/leaved. Rader utan
+   clientId, och avsändare utöver MP_API_CONFLATE_CLIENTS, lämnas orörda. */
+static void conflate_lines(MultiplayerApi *api) {
+    api->skip_head = 0;
+    api->skip_count = 0;
+
+    const char *first = api->rx + api->rx_start;
+    const char *last = api->rx + api->rx_end;
+
+    /* Vanligast är en rad i taget, och då finns inget att slå ihop */
+    int lines = 0;
+    for (const char *p = first; p < last; p++) {
+        const char *nl = (const char *)memchr(p, '\n', (size_t)(last - p));
+        if (!nl) break;
+        if (nl > p) lines++;
+        p = nl;
+    }
+    if (lines < 2) return;
+
+    atomic_fetch_add(&api->rx_backlogs, 1);
+    if (lines > atomic_load(&api->rx_max_backlog)) {
+        atomic_store(&api->rx_max_backlog, lines);
+    }
+    if (!api->classify) return;
+
+    struct {
+        Span id;
+        int superseded; /* en senare ögonblicksbild finns */
+    } clients[MP_API_CONFLATE_CLIENTS];
+    int nclients = 0;
+    int n = MP_API_SKIP_MAX; /* skip fylls bakifrån */
+
+    /* end står på radens '\n'; inledande bytes efter sista '\n' är en
+       ofullständig rad */
+    const char *end = last;
+    while (end > first && end[-1] != '\n') end--;
+    end = end > first ? end - 1 : NULL;
+
+    while (end && n > 0) {
+        const char *begin = end;
+        while (begin > first && begin[-1] != '\n') begin--;
+        size_t len = (size_t)(end - begin);
+        end = begin > first ? begin - 1 : NULL;
+
+        Span cmd, client, data;
+        if (len == 0 || !scan_envelope(begin, len, &cmd, &client, &data) || !client.p) continue;
+
+        int c = 0;
+        while (c < nclients && !(clients[c].id.len == client.len &&
+                                 memcmp(clients[c].id.p, client.p, client.len) == 0)) c++;
+        if (c == nclients) {
+            if (nclients == MP_API_CONFLATE_CLIENTS) continue;
+            clients[c].id = client;
+            clients[c].superseded = 0;
+            nclients++;
+        }
+
+        if (span_is(cmd, "joined") || span_is(cmd, "leaved")) {
+            clients[c].superseded = 0;
+            continue;
+        }
+        if (!span_is(cmd, "game") || !data.p) continue;
+
+        MpApiMsgKind kind = api->classify(data.p, data.len, api->classify_user_data);
+        if (kind == MP_API_MSG_EVENT) continue;
+
+        if (clients[c].superseded) {
+            api->skip[--n] = (size_t)(begin - api->rx);
+        } else if (kind == MP_API_MSG_SNAPSHOT) {
+            clients[c].superseded = 1;
+        }
     }
 
+    api->skip_count = MP_API_SKIP_MAX - n;
+    memmove(api->skip, api->skip + n, (size_t)api->skip_count * sizeof(api->skip[0]));
+}
+
+static void *recv_thread_main(void *arg) {
+    MultiplayerApi *api = (MultiplayerApi *)arg;
+
+    /* Det som kom i samma recv som svaret på host/join ligger redan i rx */
+    do {
+        const char *line;
+        size_t len;
+        while (next_line(api, &line, &len)) {
+            process_line(api, line, len);
+        }
+    } while (recv_some(api, 0) > 0);
+
+    /* Väck en read_reply som annars skulle vänta för evigt */
+    pthread_mutex_lock(&api->lock);
+    api->running = 0;
+    pthread_cond_broadcast(&api->reply_ready);
+    pthread_mutex_unlock(&api->lock);
+
     return NULL;
 }
 
+static int start_send_thread(MultiplayerApi *api) {
+    api->sq_stopping = 0;
+    api->sq_failed = 0;
+    if (pthread_create(&api->send_thread, NULL, send_thread_main, api) != 0) {
+        return MP_API_ERR_IO;
+    }
+    api->send_thread_started = 1;
+    return MP_API_OK;
+}
+
 static int start_recv_thread(MultiplayerApi *api) {
     if (!api) return MP_API_ERR_ARGUMENT;
     if (api->recv_thread_started) {
         return MP_API_OK;
     }
+    if (api->delivery == MP_API_DELIVER_PUMP) {
+        return MP_API_OK; /* anroparen läser själv med mp_api_process */
+    }
 
     api->running = 1;
     int rc = pthread_create(&api->recv_thread, NULL, recv_thread_main, api);
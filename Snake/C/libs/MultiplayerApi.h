@@ -1,6 +1,7 @@
 #ifndef MULTIPLAYER_API_H
 #define MULTIPLAYER_API_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include "jansson/jansson.h"
 
@@ -19,6 +20,58 @@ typedef void (*MultiplayerListener)(
     void *user_data         /* godtycklig pekare som skickas vidare */
 );
 
+/* Får varje mottagen rad (len bytes, utan radslut) innan den tolkas till
+   ett JSON-träd. Returnera 1 om raden är hanterad; då byggs inget träd och
+   lyssnarna anropas inte. Returnera 0 så går raden den vanliga vägen.
+   line gäller bara under anropet. */
+typedef int (*MultiplayerLineHandler)(const char *line, size_t len, void *user_data);
+
+/* Hur inkommande events levereras till lyssnarna. */
+typedef enum {
+    MP_API_DELIVER_THREAD = 0, /* direkt på mottagartråden (standard) */
+    MP_API_DELIVER_QUEUED = 1, /* via en låsfri kö, körs av mp_api_dispatch */
+    MP_API_DELIVER_PUMP = 2    /* ingen tråd; anroparen kör mp_api_process */
+} MpApiDelivery;
+
+/* Räknare för det som skickats till servern. */
+typedef struct {
+    long messages;  /* hela meddelanden som skickats */
+    long bytes;     /* bytes inklusive radslut */
+    long syscalls;  /* send-anrop; 1 per meddelande så länge inget delas upp */
+    int queued;     /* meddelanden i sändkön just nu */
+    int max_queued; /* största djupet sändkön haft */
+    long dropped;   /* slängda med MP_API_SEND_DROP_OLDEST */
+    long coalesced; /* ersatta med MP_API_SEND_COALESCE */
+    long rejected;  /* avvisade med MP_API_ERR_FULL */
+} MpApiSendStats;
+
+/* Räknare för det som tagits emot. */
+typedef struct {
+    long messages;    /* hela rader som lästs från servern */
+    long skipped;     /* game-rader som hoppats över för att en nyare fanns */
+    long backlogs;    /* gånger fler än en rad väntade på en gång */
+    int max_backlog;  /* flest väntande rader på en gång */
+} MpApiRecvStats;
+
+/* Hur ett game-meddelande förhåller sig till avsändarens tillstånd. */
+typedef enum {
+    MP_API_MSG_EVENT = 0,    /* levereras alltid, i ordning */
+    MP_API_MSG_UPDATE = 1,   /* en ändring; onödig före en senare ögonblicksbild */
+    MP_API_MSG_SNAPSHOT = 2  /* hela tillståndet; ersätter det som kom före */
+} MpApiMsgKind;
+
+/* Får data-objektet (len bytes JSON, inte NUL-avslutat) i ett mottaget
+   game-meddelande och talar om vilken sort det är. */
+typedef MpApiMsgKind (*MultiplayerMsgClassifier)(const char *data, size_t len, void *user_data);
+
+/* Vad mp_api_game gör när sändkön är full. */
+typedef enum {
+    MP_API_SEND_DROP_OLDEST = 0, /* släng det äldsta köade meddelandet */
+    MP_API_SEND_COALESCE = 1     /* ersätt det senast köade om båda är hela
+                                    tillstånd (mp_api_game_state_text), annars
+                                    avvisa det nya med MP_API_ERR_FULL */
+} MpApiSendPolicy;
+
 /* Returkoder */
 enum {
     MP_API_OK = 0,
@@ -27,7 +80,8 @@ enum {
     MP_API_ERR_CONNECT = 3,
     MP_API_ERR_PROTOCOL = 4,
     MP_API_ERR_IO = 5,
-    MP_API_ERR_REJECTED = 6  /* t.ex. ogiltigt sessions‑ID vid join */
+    MP_API_ERR_REJECTED = 6, /* t.ex. ogiltigt sessions‑ID vid join */
+    MP_API_ERR_FULL = 7      /* sändkön full; meddelandet skickades inte */
 };
 
 /* Skapar en ny API‑instans. Returnerar NULL vid fel. */
@@ -72,6 +126,17 @@ int mp_api_join(MultiplayerApi *api,
 /* Skickar ett "game"‑meddelande med godtycklig JSON‑data till sessionen. */
 int mp_api_game(MultiplayerApi *api, json_t *data);
 
+/* Som mp_api_game, men data är ett redan serialiserat JSON-objekt (len
+   bytes, utan radslut). Inget JSON-träd byggs och i stadigt läge allokeras
+   ingenting per meddelande. */
+int mp_api_game_text(MultiplayerApi *api, const char *data, size_t len);
+
+/* Som mp_api_game_text, men data är avsändarens hela tillstånd och gör
+   tidigare sådana meddelanden överflödiga. Bara sådana får ersätta
+   varandra i en full kö med MP_API_SEND_COALESCE; allt annat (ändringar,
+   förfrågningar) skrivs aldrig över. */
+int mp_api_game_state_text(MultiplayerApi *api, const char *data, size_t len);
+
 /* Registrerar en lyssnare för inkommande events.
    Returnerar ett positivt listener‑ID, eller −1 vid fel. */
 int mp_api_listen(MultiplayerApi *api,
@@ -81,6 +146,84 @@ int mp_api_listen(MultiplayerApi *api,
 /* Avregistrerar lyssnare. Listener‑ID är värdet från mp_api_listen. */
 void mp_api_unlisten(MultiplayerApi *api, int listener_id);
 
+/* Väljer leveranssätt. Måste anropas före mp_api_host/mp_api_join.
+   Med MP_API_DELIVER_QUEUED lägger mottagartråden avkodade events i en
+   begränsad lock-free single-producer/single-consumer-kö i stället för att
+   anropa lyssnarna, och spelloopen kör dem på sin egen tråd med
+   mp_api_dispatch, t.ex. i början av varje tick. Då ändras spelets
+   tillstånd bara mellan två ticks och aldrig mitt i en ritning. */
+int mp_api_set_delivery(MultiplayerApi *api, MpApiDelivery mode);
+
+/* Sätter en radhanterare (NULL tar bort den). Måste anropas före
+   mp_api_host/mp_api_join. Den körs där lyssnarna annars skulle köras,
+   alltså inte med MP_API_DELIVER_QUEUED, där den ignoreras. */
+int mp_api_set_line_handler(MultiplayerApi *api,
+                            MultiplayerLineHandler handler,
+                            void *user_data);
+
+/* Kör lyssnarna för ett event som om det kommit från servern, direkt på
+   anroparens tråd och oavsett leveranssätt (tester, benchmarks). data kan
+   vara NULL; callern behåller sin referens. */
+void mp_api_deliver(MultiplayerApi *api,
+                    const char *event,
+                    int64_t messageId,
+                    const char *clientId,
+                    json_t *data);
+
+/* Kör lyssnarna för högst max_events köade events (0 = alla som väntar)
+   på anroparens tråd. Returnerar antalet körda events. */
+int mp_api_dispatch(MultiplayerApi *api, int max_events);
+
+/* Antal events som släppts för att kön var full. */
+long mp_api_dropped_events(MultiplayerApi *api);
+
+/* Socketen för anslutningen, eller -1 innan mp_api_host/mp_api_join har
+   anslutit och efter att den stängts. Med MP_API_DELIVER_PUMP läggs den i
+   anroparens epoll/poll och mp_api_process körs när den blir läsbar
+   (EPOLLIN). Ett nytt värde betyder en ny anslutning. */
+int mp_api_fd(MultiplayerApi *api);
+
+/* Stänger anslutningen och glömmer sessionen, så att mp_api_host/mp_api_join
+   kan ansluta på nytt. Köade meddelanden som inte skickats släpps; lyssnare
+   och inställningar finns kvar. Får inte anropas från en lyssnare eller
+   radhanterare. */
+void mp_api_disconnect(MultiplayerApi *api);
+
+/* Läser det som finns på socketen utan att blockera och kör lyssnarna på
+   anroparens tråd, för högst budget meddelanden (0 = allt som finns).
+   Kräver MP_API_DELIVER_PUMP. Returnerar antalet hanterade meddelanden;
+   är det lika med budget kan fler redan ligga buffrade och funktionen bör
+   anropas igen. Returnerar -1 när servern har stängt anslutningen; då har
+   den redan stängts även här (se mp_api_disconnect) och mp_api_fd ger -1.
+   Tas socketen ur en epoll efter det har kärnan redan släppt den. */
+int mp_api_process(MultiplayerApi *api, int budget);
+
+/* Gör mp_api_game asynkron: meddelandet serialiseras in i en kö med plats
+   för capacity meddelanden och en egen sändtråd skickar det, så spelets
+   tick aldrig blockerar på en full socket. policy styr vad som händer när
+   kön är full. host/join/list skickas fortfarande direkt. Kan bara anropas
+   en gång. */
+int mp_api_set_send_queue(MultiplayerApi *api, int capacity, MpApiSendPolicy policy);
+
+/* Slår ihop köade game-meddelanden per avsändare (NULL stänger av).
+   Väntar flera rader när de läses, t.ex. efter att spelloopen hackat,
+   levereras bara varje avsändares senaste ögonblicksbild och det som
+   kommer efter den; äldre MP_API_MSG_SNAPSHOT och MP_API_MSG_UPDATE från
+   samma clientId hoppas över utan att tolkas. Events och "joined"/"leaved"
+   levereras alltid och i ordning, och inget slås ihop över en
+   "joined"/"leaved" för samma klient. Gäller rader som väntar i
+   mottagningsbufferten, inte events redan i MP_API_DELIVER_QUEUED-kön.
+   Måste anropas före mp_api_host/mp_api_join. */
+int mp_api_set_conflation(MultiplayerApi *api,
+                          MultiplayerMsgClassifier classify,
+                          void *user_data);
+
+/* Kopierar mottagningsräknarna till out. */
+void mp_api_recv_stats(MultiplayerApi *api, MpApiRecvStats *out);
+
+/* Kopierar sändräknarna till out. */
+void mp_api_send_stats(MultiplayerApi *api, MpApiSendStats *out);
+
 #ifdef __cplusplus
 }
 #endif
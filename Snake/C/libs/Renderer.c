@@ -0,0 +1,191 @@
+#include "Renderer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+
+typedef struct {
+    char bytes[4];
+    unsigned char len;
+} GlyphBytes;
+
+// UTF-8 bytes of every glyph, so composing a cell is a short copy
+static const GlyphBytes glyph_bytes[GLYPH_COUNT] = {
+    [GLYPH_EMPTY] = { " ", 1 },
+    [GLYPH_FOOD]  = { "\xc3\x93", 2 }, // "Ó"
+    [GLYPH_HEAD1] = { "@", 1 },
+    [GLYPH_BODY1] = { "#", 1 },
+    [GLYPH_HEAD2] = { "8", 1 },
+    [GLYPH_BODY2] = { "%", 1 },
+};
+
+void renderer_init(Renderer *r, int fd) {
+    r->fd = fd;
+    r->out_len = 0;
+    renderer_invalidate(r);
+}
+
+// Forget what is on screen so the next frame is a full repaint
+void renderer_invalidate(Renderer *r) {
+    r->width = 0;
+    r->height = 0;
+    r->status[0] = '\0';
+}
+
+// --- Output buffer ---
+
+static void put_bytes(Renderer *r, const char *s, size_t n) {
+    memcpy(r->out + r->out_len, s, n);
+    r->out_len += n;
+}
+
+static void put_text(Renderer *r, const char *s) {
+    put_bytes(r, s, strlen(s));
+}
+
+static void put_repeat(Renderer *r, char c, int n) {
+    memset(r->out + r->out_len, c, (size_t)n);
+    r->out_len += (size_t)n;
+}
+
+static void put_glyph(Renderer *r, unsigned char g) {
+    put_bytes(r, glyph_bytes[g].bytes, glyph_bytes[g].len);
+}
+
+static void put_uint(Renderer *r, unsigned int v) {
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) r->out[r->out_len++] = digits[--n];
+}
+
+// Cursor to a 1-based row and column
+static void put_cursor(Renderer *r, int row, int col) {
+    put_bytes(r, "\033[", 2);
+    put_uint(r, (unsigned int)row);
+    r->out[r->out_len++] = ';';
+    put_uint(r, (unsigned int)col);
+    r->out[r->out_len++] = 'H';
+}
+
+// --- Frame ---
+
+static void paint_snake(Renderer *r, int width, int height, const SnakeBody *b,
+                        Glyph head, Glyph body) {
+    for (int i = b->length - 1; i >= 0; i--) {
+        const Segment *s = body_at_const(b, i);
+        if (s->x < 0 || s->y < 0 || s->x >= width || s->y >= height) continue;
+        r->frame[s->y * width + s->x] = (unsigned char)(i == 0 ? head : body);
+    }
+}
+
+// Cell-to-glyph map in one pass over the entities instead of searching them
+// for every cell. Painted from the lowest priority up, so where things
+// overlap food wins over player 1, which wins over player 2.
+static void build_frame(Renderer *r, const GameWorld *w, int show_opponent) {
+    int width = w->width, height = w->height;
+    memset(r->frame, GLYPH_EMPTY, (size_t)width * height);
+
+    if (show_opponent && w->player_count > 1)
+        paint_snake(r, width, height, &w->players[1].body, GLYPH_HEAD2, GLYPH_BODY2);
+
+    paint_snake(r, width, height, &w->players[0].body, GLYPH_HEAD1, GLYPH_BODY1);
+
+    for (int f = 0; f < w->food_count; f++) {
+        int x = w->foodX[f], y = w->foodY[f];
+        if (x < 0 || y < 0 || x >= width || y >= height) continue;
+        r->frame[y * width + x] = GLYPH_FOOD;
+    }
+}
+
+static void compose_full(Renderer *r, int width, int height) {
+    put_text(r, "\033[H\033[2J");
+
+    put_repeat(r, '-', width + 2);
+    put_bytes(r, "\n", 1);
+
+    for (int y = 0; y < height; y++) {
+        put_bytes(r, "|", 1);
+        const unsigned char *row = &r->frame[y * width];
+        for (int x = 0; x < width; x++) {
+            put_glyph(r, row[x]);
+        }
+        put_bytes(r, "|\n", 2);
+    }
+
+    put_repeat(r, '-', width + 2);
+    put_bytes(r, "\n", 1);
+}
+
+// Only the cells that differ from the screen; the cursor is moved only when
+// the next changed cell is not the one right after the last one written
+static void compose_changes(Renderer *r, int width, int height) {
+    int cursor_x = -1, cursor_y = -1;
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int i = y * width + x;
+            if (r->frame[i] == r->shown[i]) continue;
+
+            if (y != cursor_y || x != cursor_x) {
+                put_cursor(r, y + 2, x + 2); // inside the border
+            }
+            put_glyph(r, r->frame[i]);
+            cursor_x = x + 1;
+            cursor_y = y;
+        }
+    }
+}
+
+void renderer_compose(Renderer *r, const GameWorld *w, int show_opponent, const char *status) {
+    r->out_len = 0;
+    build_frame(r, w, show_opponent);
+
+    if (r->width != w->width || r->height != w->height) {
+        compose_full(r, w->width, w->height);
+        r->width = w->width;
+        r->height = w->height;
+        r->status[0] = '\0';
+    } else {
+        compose_changes(r, w->width, w->height);
+    }
+    memcpy(r->shown, r->frame, (size_t)w->width * w->height);
+
+    // Status line sits right under the lower border
+    if (strcmp(status, r->status) != 0) {
+        snprintf(r->status, sizeof(r->status), "%s", status);
+        put_cursor(r, w->height + 3, 1);
+        put_text(r, r->status);
+        put_text(r, "\033[K");
+    }
+    put_cursor(r, w->height + 4, 1);
+}
+
+long renderer_draw(Renderer *r, const GameWorld *w, int show_opponent, const char *status) {
+    renderer_compose(r, w, show_opponent, status);
+
+    // Anything printed through stdio before this frame goes out first
+    fflush(stdout);
+
+    size_t done = 0;
+    while (done < r->out_len) {
+        ssize_t n = write(r->fd, r->out + done, r->out_len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) {
+                // The terminal shares stdin's O_NONBLOCK; wait for room
+                struct pollfd pfd = { .fd = r->fd, .events = POLLOUT };
+                poll(&pfd, 1, -1);
+                continue;
+            }
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    return (long)done;
+}
@@ -0,0 +1,58 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <stddef.h>
+
+#include "GameWorld.h"
+
+// Terminal board renderer that remembers what is on screen and only sends
+// the cells that changed since the last frame, each behind a cursor move.
+// A moving snake changes about three cells per tick, so a frame is tens of
+// bytes instead of the whole board. The board is repainted in full on the
+// first frame, when the arena changes size, and after renderer_invalidate().
+//
+// A frame is composed into a preallocated buffer from a table of ready-made
+// glyph bytes and goes out in a single write(), so drawing costs no stdio
+// formatting and one syscall per tick.
+
+typedef enum {
+    GLYPH_EMPTY,
+    GLYPH_FOOD,
+    GLYPH_HEAD1, // player 1 (us)
+    GLYPH_BODY1,
+    GLYPH_HEAD2, // player 2 / online opponent
+    GLYPH_BODY2,
+    GLYPH_COUNT
+} Glyph;
+
+#define STATUS_LINE_MAX 128
+
+// Worst case is a diff where every other cell changed: cursor move
+// ("\033[rr;ccH", 8 bytes) plus a glyph of up to 4 bytes per cell
+#define RENDER_BUFFER_SIZE (MAX_WIDTH * MAX_HEIGHT * 12 + 4 * (MAX_WIDTH + 2) + STATUS_LINE_MAX + 64)
+
+typedef struct {
+    int fd;      // where frames are written
+    int width;   // size of the board on screen, 0 when nothing is drawn
+    int height;
+    unsigned char shown[MAX_WIDTH * MAX_HEIGHT]; // Glyph per cell on screen
+    unsigned char frame[MAX_WIDTH * MAX_HEIGHT]; // Glyph per cell this frame
+    char status[STATUS_LINE_MAX];                // status line on screen
+
+    char out[RENDER_BUFFER_SIZE]; // bytes of the frame being composed
+    size_t out_len;
+} Renderer;
+
+void renderer_init(Renderer *r, int fd);
+void renderer_invalidate(Renderer *r);
+
+// Composes the board of w below the top-left corner, then the status line,
+// into r->out without writing it. show_opponent draws player 2 as well.
+// Leaves the cursor on the line after the status line.
+void renderer_compose(Renderer *r, const GameWorld *w, int show_opponent, const char *status);
+
+// renderer_compose() and one write() of the frame. Returns the bytes written
+// or -1 on error.
+long renderer_draw(Renderer *r, const GameWorld *w, int show_opponent, const char *status);
+
+#endif //RENDERER_H
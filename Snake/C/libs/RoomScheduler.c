@@ -0,0 +1,246 @@
+#include "RoomScheduler.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define ROOM_CHUNK 8          // rooms claimed per fetch from a shard
+#define ROYALE_EVERY 16       // every 16th room is a full royale
+
+// Each shard sits on its own cache line so claiming a chunk in one shard
+// never invalidates another shard's cursor.
+typedef struct {
+    _Alignas(64) atomic_int next; // next unclaimed room, relative to begin
+    int begin, end;
+} RoomShard;
+
+typedef struct {
+    RoomScheduler *sched;
+    int index;
+    pthread_t thread;
+} RoomWorker;
+
+struct RoomScheduler {
+    Room *rooms;
+    int room_count;
+
+    RoomShard *shards;
+    RoomWorker *workers;
+    RoomWorkerStats *stats; // one entry per worker, written at the end of its tick
+    int worker_count;
+    int threads_started;
+
+    // Tick hand-off: bumping generation releases the workers, pending counts
+    // down to zero as they finish.
+    pthread_mutex_t lock;
+    pthread_cond_t go;
+    pthread_cond_t finished;
+    long generation;
+    int pending;
+    int stopping;
+
+    long tick;
+    double budget_ms;
+};
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void setup_room(Room *r, int index, unsigned int seed) {
+    GameWorld *w = &r->world;
+
+    if (index % ROYALE_EVERY == ROYALE_EVERY - 1) {
+        world_init(w, WORLD_ROYALE, MAX_PLAYERS, seed);
+        world_set_arena(w, MAX_WIDTH, MAX_HEIGHT);
+        world_reset(w);
+    } else if (index % 2) {
+        world_init(w, WORLD_LOCAL_1V1, 2, seed);
+    } else {
+        world_init(w, WORLD_SINGLEPLAYER, 1, seed);
+    }
+}
+
+static void step_room(Room *r, int index) {
+    GameWorld *w = &r->world;
+    WorldInput in;
+
+    world_bot_input(w, &in);
+    world_step(w, &in);
+
+    // Royale shrinks as the field thins out; a match ends when it is decided
+    int alive = world_alive_count(w);
+    w->active_players = alive;
+
+    int over = (alive == 0) ||
+               (w->mode == WORLD_LOCAL_1V1 && alive < 2) ||
+               (w->mode == WORLD_ROYALE && alive <= 1);
+    if (over) {
+        r->matches++;
+        setup_room(r, index, world_rand(w));
+    }
+}
+
+// Drains one shard chunk by chunk. Returns the number of rooms stepped.
+static int drain_shard(RoomScheduler *s, RoomShard *sh) {
+    int stepped = 0;
+    for (;;) {
+        int first = sh->begin + atomic_fetch_add_explicit(&sh->next, ROOM_CHUNK, memory_order_relaxed);
+        if (first >= sh->end) break;
+
+        int last = first + ROOM_CHUNK;
+        if (last > sh->end) last = sh->end;
+        for (int i = first; i < last; i++)
+            step_room(&s->rooms[i], i);
+        stepped += last - first;
+    }
+    return stepped;
+}
+
+static void *worker_main(void *arg) {
+    RoomWorker *wk = (RoomWorker *)arg;
+    RoomScheduler *s = wk->sched;
+    long seen = 0;
+
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        while (s->generation == seen && !s->stopping)
+            pthread_cond_wait(&s->go, &s->lock);
+        if (s->stopping) break;
+        seen = s->generation;
+        pthread_mutex_unlock(&s->lock);
+
+        double t0 = now_ms();
+
+        // Own shard first, then steal from the others in ring order
+        int own = drain_shard(s, &s->shards[wk->index]);
+        int stolen = 0;
+        for (int k = 1; k < s->worker_count; k++)
+            stolen += drain_shard(s, &s->shards[(wk->index + k) % s->worker_count]);
+
+        RoomWorkerStats *st = &s->stats[wk->index];
+        st->busy_ms = now_ms() - t0;
+        st->budget_pct = s->budget_ms > 0 ? 100.0 * st->busy_ms / s->budget_ms : 0;
+        st->rooms_stepped = own + stolen;
+        st->rooms_stolen = stolen;
+
+        pthread_mutex_lock(&s->lock);
+        if (--s->pending == 0)
+            pthread_cond_signal(&s->finished);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+RoomScheduler *room_scheduler_create(int room_count, int worker_count, int tick_rate) {
+    if (room_count < 1) return NULL;
+    if (worker_count < 1) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        worker_count = cores > 0 ? (int)cores : 1;
+    }
+
+    RoomScheduler *s = (RoomScheduler *)calloc(1, sizeof(RoomScheduler));
+    if (!s) return NULL;
+
+    s->room_count = room_count;
+    s->worker_count = worker_count;
+    s->budget_ms = tick_rate > 0 ? 1000.0 / tick_rate : 0;
+
+    s->rooms = (Room *)calloc((size_t)room_count, sizeof(Room));
+    s->shards = (RoomShard *)aligned_alloc(64, sizeof(RoomShard) * (size_t)worker_count);
+    s->workers = (RoomWorker *)calloc((size_t)worker_count, sizeof(RoomWorker));
+    s->stats = (RoomWorkerStats *)calloc((size_t)worker_count, sizeof(RoomWorkerStats));
+    if (!s->rooms || !s->shards || !s->workers || !s->stats) {
+        room_scheduler_destroy(s);
+        return NULL;
+    }
+
+    for (int i = 0; i < room_count; i++)
+        setup_room(&s->rooms[i], i, (unsigned int)i * 2654435761u + 1);
+
+    // Contiguous shards; royales are spread evenly by ROYALE_EVERY
+    for (int k = 0; k < worker_count; k++) {
+        s->shards[k].begin = (int)((long)room_count * k / worker_count);
+        s->shards[k].end = (int)((long)room_count * (k + 1) / worker_count);
+        atomic_init(&s->shards[k].next, 0);
+    }
+
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->go, NULL);
+    pthread_cond_init(&s->finished, NULL);
+
+    for (int k = 0; k < worker_count; k++) {
+        s->workers[k].sched = s;
+        s->workers[k].index = k;
+        if (pthread_create(&s->workers[k].thread, NULL, worker_main, &s->workers[k]) != 0) {
+            room_scheduler_destroy(s);
+            return NULL;
+        }
+        s->threads_started = k + 1;
+    }
+
+    return s;
+}
+
+void room_scheduler_destroy(RoomScheduler *s) {
+    if (!s) return;
+
+    if (s->threads_started > 0) {
+        pthread_mutex_lock(&s->lock);
+        s->stopping = 1;
+        pthread_cond_broadcast(&s->go);
+        pthread_mutex_unlock(&s->lock);
+        for (int k = 0; k < s->threads_started; k++)
+            pthread_join(s->workers[k].thread, NULL);
+
+        pthread_cond_destroy(&s->finished);
+        pthread_cond_destroy(&s->go);
+        pthread_mutex_destroy(&s->lock);
+    }
+
+    free(s->stats);
+    free(s->workers);
+    free(s->shards);
+    free(s->rooms);
+    free(s);
+}
+
+void room_scheduler_tick(RoomScheduler *s, RoomTickStats *out_stats) {
+    if (!s) return;
+
+    for (int k = 0; k < s->worker_count; k++)
+        atomic_store_explicit(&s->shards[k].next, 0, memory_order_relaxed);
+
+    double t0 = now_ms();
+    pthread_mutex_lock(&s->lock);
+    s->pending = s->threads_started;
+    s->generation++;
+    pthread_cond_broadcast(&s->go);
+    while (s->pending > 0)
+        pthread_cond_wait(&s->finished, &s->lock);
+    pthread_mutex_unlock(&s->lock);
+    double wall = now_ms() - t0;
+
+    s->tick++;
+    if (out_stats) {
+        out_stats->tick = s->tick;
+        out_stats->wall_ms = wall;
+        out_stats->budget_ms = s->budget_ms;
+        out_stats->worker_count = s->worker_count;
+        out_stats->workers = s->stats;
+    }
+}
+
+int room_scheduler_room_count(const RoomScheduler *s) {
+    return s ? s->room_count : 0;
+}
+
+Room *room_scheduler_room(RoomScheduler *s, int index) {
+    if (!s || index < 0 || index >= s->room_count) return NULL;
+    return &s->rooms[index];
+}
@@ -0,0 +1,47 @@
+#ifndef ROOMSCHEDULER_H
+#define ROOMSCHEDULER_H
+
+#include "GameWorld.h"
+
+// Steps many independent rooms (one GameWorld each) per tick on a pool of
+// worker threads. Every worker owns a shard of rooms and claims them in
+// small chunks; a worker that runs dry steals chunks from the other shards,
+// so one slow room (a big royale) only holds back the chunk it is in.
+
+typedef struct RoomScheduler RoomScheduler;
+
+typedef struct {
+    GameWorld world;
+    long matches; // finished matches, the room restarts after each one
+} Room;
+
+// Per-worker numbers for the most recent tick
+typedef struct {
+    double busy_ms;     // time spent stepping rooms
+    double budget_pct;  // busy_ms as a percentage of the tick budget
+    int rooms_stepped;
+    int rooms_stolen;   // rooms taken from another worker's shard
+} RoomWorkerStats;
+
+typedef struct {
+    long tick;
+    double wall_ms;     // time from releasing the workers until all were done
+    double budget_ms;   // 1000 / tick rate
+    int worker_count;
+    const RoomWorkerStats *workers;
+} RoomTickStats;
+
+/* Creates room_count rooms split over worker_count threads (0 = one per
+   online core). Returns NULL on error. */
+RoomScheduler *room_scheduler_create(int room_count, int worker_count, int tick_rate);
+
+/* Stops the workers and frees every room. */
+void room_scheduler_destroy(RoomScheduler *s);
+
+/* Steps every room once; blocks until all workers are done. */
+void room_scheduler_tick(RoomScheduler *s, RoomTickStats *out_stats);
+
+int room_scheduler_room_count(const RoomScheduler *s);
+Room *room_scheduler_room(RoomScheduler *s, int index);
+
+#endif //ROOMSCHEDULER_H
@@ -0,0 +1,612 @@
+#include "SnakeSync.h"
+
+#include <limits.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// -------------------------------
+// Packed body
+// -------------------------------
+
+static const char dir_digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const int dir_dx[4] = { 0, 1, 0, -1 };
+static const int dir_dy[4] = { -1, 0, 1, 0 };
+
+static int dir_between(const Segment* from, const Segment* to) {
+    int dx = to->x - from->x, dy = to->y - from->y;
+    for (int d = 0; d < 4; d++)
+        if (dir_dx[d] == dx && dir_dy[d] == dy) return d;
+    return -1;
+}
+
+static int digit_value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+int sync_encode_dirs(const SnakeBody* b, char* out) {
+    int n = 0, bits = 0, shift = 0;
+    for (int i = 1; i < b->length; i++) {
+        int d = dir_between(body_at_const(b, i - 1), body_at_const(b, i));
+        if (d < 0) return -1;
+        bits |= d << shift;
+        shift += 2;
+        if (shift == 6) {
+            out[n++] = dir_digits[bits];
+            bits = shift = 0;
+        }
+    }
+    if (shift > 0) out[n++] = dir_digits[bits];
+    out[n] = '\0';
+    return n;
+}
+
+int sync_decode_dirs(SnakeBody* b, Segment head, int length, const char* dirs) {
+    if (length < 1 || length > MAX_LEN) return -1;
+
+    body_clear(b);
+    body_append(b, head);
+    Segment s = head;
+    int bits = 0, left = 0;
+    for (int i = 1; i < length; i++) {
+        if (left == 0) {
+            bits = digit_value(*dirs++);
+            if (bits < 0) return -1; // also catches a string that ends early
+            left = 3;
+        }
+        s.x += dir_dx[bits & 3];
+        s.y += dir_dy[bits & 3];
+        body_append(b, s);
+        bits >>= 2;
+        left--;
+    }
+    return 0;
+}
+
+// -------------------------------
+// Sender
+// -------------------------------
+
+void sync_sender_reset(SyncSender* s) {
+    memset(s, 0, sizeof(*s));
+    s->need_keyframe = 1;
+}
+
+void sync_request_keyframe(SyncSender* s) {
+    s->need_keyframe = 1;
+}
+
+// Appends to a caller's buffer; once it overflows everything else is dropped
+typedef struct {
+    char* buf;
+    size_t cap;
+    size_t len;
+    int overflow;
+} SyncOut;
+
+static void out_printf(SyncOut* o, const char* fmt, ...) {
+    if (o->overflow) return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->buf + o->len, o->cap - o->len, fmt, ap);
+    va_end(ap);
+
+    if (n < 0 || (size_t)n >= o->cap - o->len) o->overflow = 1;
+    else o->len += (size_t)n;
+}
+
+static void write_plain_body(SyncOut* o, const SnakeBody* b) {
+    out_printf(o, ",\"body\":[");
+    for (int i = 0; i < b->length; i++) {
+        const Segment* seg = body_at_const(b, i);
+        out_printf(o, "%s{\"x\":%d,\"y\":%d}", i ? "," : "", seg->x, seg->y);
+    }
+    out_printf(o, "]");
+}
+
+static void write_keyframe(SyncSender* s, SyncOut* o, const SnakeBody* b) {
+    char dirs[SYNC_DIRS_MAX];
+    if (!s->plain_body && b->length > 0 && sync_encode_dirs(b, dirs) >= 0) {
+        const Segment* head = body_at_const(b, 0);
+        out_printf(o, ",\"hx\":%d,\"hy\":%d,\"n\":%d,\"bd\":\"%s\"", head->x, head->y, b->length, dirs);
+    } else {
+        write_plain_body(o, b);
+    }
+
+    s->need_keyframe = 0;
+    s->keyframe_in = SYNC_KEYFRAME_TICKS;
+    s->wrote_keyframe = 1;
+    s->keyframes++;
+}
+
+int sync_write(SyncSender* s, const SnakeBody* b, const Segment* food, char* out, size_t cap) {
+    SyncOut o = { out, cap, 0, 0 };
+    out_printf(&o, "{\"q\":%ld", ++s->seq);
+
+    Segment head = b->length > 0 ? *body_at_const(b, 0) : (Segment){0, 0};
+    int grew = b->length - s->sent_length;
+
+    // A delta can only describe one step from the last head with the tail
+    // kept, moved or cut by one; anything else (a restart) needs a keyframe
+    int stepped = b->length >= 2 &&
+                  body_at_const(b, 1)->x == s->sent_head.x &&
+                  body_at_const(b, 1)->y == s->sent_head.y &&
+                  abs(head.x - s->sent_head.x) + abs(head.y - s->sent_head.y) == 1;
+    if (s->need_keyframe || s->keyframe_in <= 0 || !stepped || grew > 1 || grew < -1) {
+        write_keyframe(s, &o, b);
+    } else {
+        out_printf(&o, ",\"hx\":%d,\"hy\":%d,\"g\":%d", head.x, head.y, grew);
+        s->keyframe_in--;
+        s->wrote_keyframe = 0;
+        s->deltas++;
+    }
+
+    if (food) out_printf(&o, ",\"fx\":%d,\"fy\":%d", food->x, food->y);
+    out_printf(&o, "}");
+
+    s->sent_length = b->length;
+    s->sent_head = head;
+
+    // The receiver would see a gap; make the next message a keyframe too
+    if (o.overflow) {
+        s->need_keyframe = 1;
+        return -1;
+    }
+    return (int)o.len;
+}
+
+// -------------------------------
+// Decoding
+// -------------------------------
+
+// The plain int fields of a data object and where they go in SyncMessage
+static const struct {
+    const char* key;
+    unsigned field;
+    size_t offset;
+} int_fields[] = {
+    { "hx", SYNC_F_HX, offsetof(SyncMessage, hx) },
+    { "hy", SYNC_F_HY, offsetof(SyncMessage, hy) },
+    { "g",  SYNC_F_G,  offsetof(SyncMessage, g) },
+    { "n",  SYNC_F_N,  offsetof(SyncMessage, n) },
+    { "fx", SYNC_F_FX, offsetof(SyncMessage, fx) },
+    { "fy", SYNC_F_FY, offsetof(SyncMessage, fy) },
+    { "w",  SYNC_F_W,  offsetof(SyncMessage, w) },
+    { "h",  SYNC_F_H,  offsetof(SyncMessage, h) },
+};
+#define INT_FIELDS (sizeof(int_fields) / sizeof(int_fields[0]))
+
+static int* int_slot(SyncMessage* m, size_t i) {
+    return (int*)((char*)m + int_fields[i].offset);
+}
+
+static void message_clear(SyncMessage* m) {
+    m->fields = 0;
+    m->client[0] = '\0';
+    m->q = 0;
+    m->hx = m->hy = m->g = m->n = 0;
+    m->bd[0] = '\0';
+    m->body_count = m->food_count = 0;
+    m->fx = m->fy = m->w = m->h = 0;
+}
+
+static int json_int(json_t* v) {
+    return (int)json_integer_value(v);
+}
+
+static int segments_from_json(json_t* arr, Segment* out, int max) {
+    int n = 0;
+    for (size_t i = 0; i < json_array_size(arr) && n < max; i++) {
+        json_t* seg = json_array_get(arr, i);
+        out[n].x = json_int(json_object_get(seg, "x"));
+        out[n].y = json_int(json_object_get(seg, "y"));
+        n++;
+    }
+    return n;
+}
+
+void sync_message_from_json(const char* clientId, json_t* data, SyncMessage* m) {
+    message_clear(m);
+    if (clientId) snprintf(m->client, sizeof(m->client), "%s", clientId);
+
+    for (size_t i = 0; i < INT_FIELDS; i++) {
+        json_t* v = json_object_get(data, int_fields[i].key);
+        *int_slot(m, i) = json_int(v);
+        if (json_is_integer(v)) m->fields |= int_fields[i].field;
+    }
+
+    json_t* q = json_object_get(data, "q");
+    if (json_is_integer(q)) {
+        m->q = (long)json_integer_value(q);
+        m->fields |= SYNC_F_Q;
+    }
+
+    json_t* bd = json_object_get(data, "bd");
+    if (json_is_string(bd)) {
+        // Anything past SYNC_DIRS_MAX - 1 digits is more than MAX_LEN needs
+        snprintf(m->bd, sizeof(m->bd), "%s", json_string_value(bd));
+        m->fields |= SYNC_F_BD;
+    }
+
+    json_t* body = json_object_get(data, "body");
+    if (json_is_array(body)) {
+        m->body_count = segments_from_json(body, m->body, m->body_max);
+        m->fields |= SYNC_F_BODY;
+    }
+
+    json_t* foods = json_object_get(data, "foods");
+    if (json_is_array(foods)) {
+        m->food_count = segments_from_json(foods, m->foods, m->foods_max);
+        m->fields |= SYNC_F_FOODS;
+    }
+
+    if (json_object_get(data, "resync")) m->fields |= SYNC_F_RESYNC;
+}
+
+// Streaming decode: a small state machine over json_sax_loadb's events
+// that only accepts the shape of a game line. Any surprise stops the
+// parser and the caller falls back to the tree.
+
+typedef enum {
+    AT_START,     // before the outer object
+    AT_ENVELOPE,  // keys of the outer object
+    AT_DATA,      // keys of "data"
+    AT_LIST,      // items of "body" or "foods"
+    AT_ITEM,      // keys of one {"x", "y"} item
+    AT_END
+} DecodeAt;
+
+typedef enum {
+    KEY_NONE,
+    KEY_CMD,      // must be "game"
+    KEY_CLIENT,   // clientId, copied into m->client
+    KEY_META,     // messageId, session: not needed here
+    KEY_DATA,
+    KEY_INT,      // an int field of the data, see field/slot
+    KEY_Q,
+    KEY_BD,
+    KEY_LIST,     // "body" or "foods"
+    KEY_RESYNC,
+    KEY_X,
+    KEY_Y
+} DecodeKey;
+
+#define DECODE_STOP 1
+
+typedef struct {
+    SyncMessage* m;
+    DecodeAt at;
+    DecodeKey key;
+    unsigned field;   // SYNC_F_* of the current data key
+    int* slot;        // where a KEY_INT value goes
+    int is_game;
+    Segment* list;    // m->body or m->foods while AT_LIST / AT_ITEM
+    int list_max;
+    int* list_count;
+    Segment item;
+    int item_has;     // 1 = x, 2 = y
+} Decoder;
+
+static int key_is(const json_sax_value_t* v, const char* name) {
+    size_t n = strlen(name);
+    return v->length == n && memcmp(v->string, name, n) == 0;
+}
+
+static int int_of(json_sax_event_t ev, const json_sax_value_t* v, int* out) {
+    if (ev != JSON_SAX_INTEGER || v->integer < INT_MIN || v->integer > INT_MAX)
+        return 0;
+    *out = (int)v->integer;
+    return 1;
+}
+
+static int decode_envelope(Decoder* d, json_sax_event_t ev, const json_sax_value_t* v) {
+    if (ev == JSON_SAX_KEY) {
+        if (key_is(v, "cmd")) d->key = KEY_CMD;
+        else if (key_is(v, "data")) d->key = KEY_DATA;
+        else if (key_is(v, "clientId")) d->key = KEY_CLIENT;
+        else if (key_is(v, "messageId") || key_is(v, "session"))
+            d->key = KEY_META;
+        else return DECODE_STOP;
+        return 0;
+    }
+    if (ev == JSON_SAX_OBJECT_END) {
+        d->at = AT_END;
+        return 0;
+    }
+
+    switch (d->key) {
+        case KEY_CMD:
+            if (ev != JSON_SAX_STRING || !key_is(v, "game")) return DECODE_STOP;
+            d->is_game = 1;
+            return 0;
+        case KEY_CLIENT:
+            if (ev == JSON_SAX_NULL) return 0;
+            if (ev != JSON_SAX_STRING || v->length >= sizeof(d->m->client)) return DECODE_STOP;
+            memcpy(d->m->client, v->string, v->length);
+            d->m->client[v->length] = '\0';
+            return 0;
+        case KEY_META:
+            return ev == JSON_SAX_STRING || ev == JSON_SAX_INTEGER || ev == JSON_SAX_NULL
+                ? 0 : DECODE_STOP;
+        case KEY_DATA:
+            if (ev != JSON_SAX_OBJECT_START) return DECODE_STOP;
+            d->at = AT_DATA;
+            return 0;
+        default:
+            return DECODE_STOP;
+    }
+}
+
+static int data_key(Decoder* d, const json_sax_value_t* v) {
+    for (size_t i = 0; i < INT_FIELDS; i++) {
+        if (key_is(v, int_fields[i].key)) {
+            d->key = KEY_INT;
+            d->field = int_fields[i].field;
+            d->slot = int_slot(d->m, i);
+            return 0;
+        }
+    }
+
+    SyncMessage* m = d->m;
+    if (key_is(v, "q")) {
+        d->key = KEY_Q;
+    } else if (key_is(v, "bd")) {
+        d->key = KEY_BD;
+    } else if (key_is(v, "body")) {
+        d->key = KEY_LIST;
+        d->field = SYNC_F_BODY;
+        d->list = m->body;
+        d->list_max = m->body_max;
+        d->list_count = &m->body_count;
+    } else if (key_is(v, "foods")) {
+        d->key = KEY_LIST;
+        d->field = SYNC_F_FOODS;
+        d->list = m->foods;
+        d->list_max = m->foods_max;
+        d->list_count = &m->food_count;
+    } else if (key_is(v, "resync")) {
+        d->key = KEY_RESYNC;
+    } else {
+        return DECODE_STOP;
+    }
+    return 0;
+}
+
+static int decode_data(Decoder* d, json_sax_event_t ev, const json_sax_value_t* v) {
+    SyncMessage* m = d->m;
+    if (ev == JSON_SAX_KEY) return data_key(d, v);
+    if (ev == JSON_SAX_OBJECT_END) {
+        d->at = AT_ENVELOPE;
+        return 0;
+    }
+
+    switch (d->key) {
+        case KEY_INT:
+            if (!int_of(ev, v, d->slot)) return DECODE_STOP;
+            m->fields |= d->field;
+            return 0;
+        case KEY_Q:
+            if (ev != JSON_SAX_INTEGER) return DECODE_STOP;
+            m->q = (long)v->integer;
+            m->fields |= SYNC_F_Q;
+            return 0;
+        case KEY_BD:
+            if (ev != JSON_SAX_STRING || v->length >= sizeof(m->bd)) return DECODE_STOP;
+            memcpy(m->bd, v->string, v->length);
+            m->bd[v->length] = '\0';
+            m->fields |= SYNC_F_BD;
+            return 0;
+        case KEY_LIST:
+            if (ev != JSON_SAX_ARRAY_START) return DECODE_STOP;
+            *d->list_count = 0;
+            m->fields |= d->field;
+            d->at = AT_LIST;
+            return 0;
+        case KEY_RESYNC:
+            if (ev == JSON_SAX_OBJECT_START || ev == JSON_SAX_ARRAY_START) return DECODE_STOP;
+            m->fields |= SYNC_F_RESYNC;
+            return 0;
+        default:
+            return DECODE_STOP;
+    }
+}
+
+static int decode_item(Decoder* d, json_sax_event_t ev, const json_sax_value_t* v) {
+    switch (ev) {
+        case JSON_SAX_KEY:
+            if (key_is(v, "x")) d->key = KEY_X;
+            else if (key_is(v, "y")) d->key = KEY_Y;
+            else return DECODE_STOP;
+            return 0;
+        case JSON_SAX_OBJECT_END:
+            if (d->item_has != 3) return DECODE_STOP;
+            d->list[(*d->list_count)++] = d->item;
+            d->at = AT_LIST;
+            return 0;
+        default:
+            if (d->key == KEY_X && int_of(ev, v, &d->item.x)) d->item_has |= 1;
+            else if (d->key == KEY_Y && int_of(ev, v, &d->item.y)) d->item_has |= 2;
+            else return DECODE_STOP;
+            return 0;
+    }
+}
+
+static int decode_event(json_sax_event_t ev, const json_sax_value_t* v, void* data) {
+    Decoder* d = data;
+    switch (d->at) {
+        case AT_START:
+            if (ev != JSON_SAX_OBJECT_START) return DECODE_STOP;
+            d->at = AT_ENVELOPE;
+            return 0;
+        case AT_ENVELOPE:
+            return decode_envelope(d, ev, v);
+        case AT_DATA:
+            return decode_data(d, ev, v);
+        case AT_LIST:
+            if (ev == JSON_SAX_ARRAY_END) {
+                d->at = AT_DATA;
+                return 0;
+            }
+            // Bounds check: a list that does not fit goes the slow way
+            if (ev != JSON_SAX_OBJECT_START || *d->list_count >= d->list_max) return DECODE_STOP;
+            d->item_has = 0;
+            d->at = AT_ITEM;
+            return 0;
+        case AT_ITEM:
+            return decode_item(d, ev, v);
+        default:
+            return DECODE_STOP;
+    }
+}
+
+int sync_decode_line(const char* line, size_t len, SyncMessage* m) {
+    Decoder d;
+    memset(&d, 0, sizeof(d));
+    d.m = m;
+    message_clear(m);
+
+    if (json_sax_loadb(line, len, 0, decode_event, &d, NULL) != 0) return 0;
+    return d.at == AT_END && d.is_game;
+}
+
+// Kind of a data object: looks at its top level keys and stops at the
+// first one that decides
+
+typedef struct {
+    int depth;
+    int has_w, has_h;
+} KindScan;
+
+static int kind_event(json_sax_event_t ev, const json_sax_value_t* v, void* data) {
+    KindScan* k = data;
+    switch (ev) {
+        case JSON_SAX_OBJECT_START:
+        case JSON_SAX_ARRAY_START:
+            k->depth++;
+            return 0;
+        case JSON_SAX_OBJECT_END:
+        case JSON_SAX_ARRAY_END:
+            if (--k->depth > 0) return 0;
+            // Only {"w", "h"} (plus the neutral keys) is a whole arena state
+            return 1 + (k->has_w && k->has_h ? SYNC_DATA_STATE : SYNC_DATA_OTHER);
+        case JSON_SAX_KEY:
+            if (k->depth != 1) return 0;
+            if (key_is(v, "bd") || key_is(v, "body")) return 1 + SYNC_DATA_STATE;
+            if (key_is(v, "g")) return 1 + SYNC_DATA_DELTA;
+            if (key_is(v, "w")) k->has_w = 1;
+            else if (key_is(v, "h")) k->has_h = 1;
+            else if (!key_is(v, "q") && !key_is(v, "hx") && !key_is(v, "hy") &&
+                     !key_is(v, "n") && !key_is(v, "fx") && !key_is(v, "fy"))
+                return 1 + SYNC_DATA_OTHER;
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+SyncDataKind sync_data_kind(const char* data, size_t len) {
+    KindScan k = { 0, 0, 0 };
+    int rc = json_sax_loadb(data, len, 0, kind_event, &k, NULL);
+    return rc > 0 ? (SyncDataKind)(rc - 1) : SYNC_DATA_OTHER;
+}
+
+// -------------------------------
+// Receiver
+// -------------------------------
+
+void sync_receiver_reset(SyncReceiver* r) {
+    memset(r, 0, sizeof(*r));
+    body_clear(&r->body);
+}
+
+static SyncResult ask_for_keyframe(SyncReceiver* r, long seq) {
+    if (r->resync_asked != 0 && seq - r->resync_asked < SYNC_RESYNC_EVERY)
+        return SYNC_IGNORED;
+    r->resync_asked = seq;
+    return SYNC_RESYNC;
+}
+
+static SyncResult keyframe_applied(SyncReceiver* r, long seq) {
+    r->last_seq = seq;
+    r->synced = 1;
+    r->resync_asked = 0;
+    r->keyframes++;
+    return SYNC_APPLIED;
+}
+
+// Binds the receiver to the first sender of snake data; 0 if m is from
+// someone else. Messages without a clientId cannot be told apart and pass.
+static int from_peer(SyncReceiver* r, const SyncMessage* m) {
+    if (m->client[0] == '\0') return 1;
+    if (r->peer[0] == '\0') {
+        memcpy(r->peer, m->client, sizeof(r->peer));
+        return 1;
+    }
+    if (strcmp(r->peer, m->client) == 0) return 1;
+    r->foreign++;
+    return 0;
+}
+
+SyncResult sync_apply(SyncReceiver* r, const SyncMessage* m) {
+    const unsigned delta = SYNC_F_HX | SYNC_F_HY | SYNC_F_G;
+    int snake = (m->fields & (SYNC_F_BODY | SYNC_F_BD)) || (m->fields & delta) == delta;
+    if (!snake || !from_peer(r, m)) return SYNC_IGNORED;
+
+    // Peers without "q" only ever send keyframes
+    long seq = (m->fields & SYNC_F_Q) ? m->q : r->last_seq + 1;
+
+    if (m->fields & SYNC_F_BODY) {
+        body_clear(&r->body);
+        for (int i = 0; i < m->body_count && i < MAX_LEN; i++)
+            body_append(&r->body, m->body[i]);
+        return keyframe_applied(r, seq);
+    }
+
+    if (m->fields & SYNC_F_BD) {
+        Segment head = { m->hx, m->hy };
+        if (sync_decode_dirs(&r->body, head, m->n, m->bd) == 0)
+            return keyframe_applied(r, seq);
+        r->synced = 0;
+        return ask_for_keyframe(r, seq);
+    }
+
+    if (!r->synced) return ask_for_keyframe(r, seq);
+
+    SnakeBody* b = &r->body;
+    Segment head = *body_at(b, 0);
+    int dx = m->hx - head.x;
+    int dy = m->hy - head.y;
+    int grew = m->g;
+    int length = b->length + grew;
+
+    // A lost delta shows as a gap in "q", or as a head that did not step
+    if (seq != r->last_seq + 1 || b->length == 0 || abs(dx) + abs(dy) != 1 ||
+        grew > 1 || grew < -1 || length < 1 || length > MAX_LEN) {
+        r->synced = 0;
+        r->gaps++;
+        return ask_for_keyframe(r, seq);
+    }
+
+    b->grow = grew > 0 ? 1 : 0;
+    body_advance(b, dx, dy, NULL);
+    while (b->length > length) body_shrink(b, NULL);
+
+    r->last_seq = seq;
+    r->deltas++;
+    return SYNC_APPLIED;
+}
+
+int sync_body_segments(const SyncReceiver* r, Segment* segs) {
+    for (int i = 0; i < r->body.length; i++)
+        segs[i] = *body_at_const(&r->body, i);
+    return r->body.length;
+}
@@ -0,0 +1,137 @@
+#ifndef SNAKESYNC_H
+#define SNAKESYNC_H
+
+#include <stddef.h>
+
+#include "jansson/jansson.h"
+#include "GameWorld.h"
+
+// Online snake state on the wire. Instead of the whole body every tick the
+// sender normally sends only the new head and how much the length changed:
+//
+//   keyframe  {"q": seq, "hx": x, "hy": y, "n": length, "bd": "<directions>"}
+//   delta     {"q": seq, "hx": x, "hy": y, "g": -1 | 0 | 1}
+//
+// A keyframe gives the head and then, for every following segment, which
+// way it lies from the one before: 2 bits each (0 up, 1 right, 2 down,
+// 3 left), three per base64 digit, lowest bits first. A 200-segment snake
+// is 67 characters. A body that is not one unbroken chain of unit steps
+// falls back to the plain {"q": seq, "body": [{"x": .., "y": ..}, ...]},
+// which is also what older peers send.
+//
+// A delta means "new head at (hx, hy), then keep the old body up to the new
+// length". Full bodies go out every SYNC_KEYFRAME_TICKS ticks, whenever the
+// head jumped (restart) and when the receiver asks for one. "q" counts the
+// sender's messages; the server's messageId is shared by every client in a
+// session, so it cannot show which of one sender's messages went missing.
+// A receiver that sees a gap ignores deltas and answers {"resync": true} until
+// the next keyframe. Since "q" only means something per sender, a receiver
+// mirrors one peer: the first clientId whose snake it sees. Snake data from
+// anyone else is counted and ignored until the receiver is reset.
+
+#define SYNC_KEYFRAME_TICKS 100
+#define SYNC_RESYNC_EVERY 10 // messages between repeated keyframe requests
+#define SYNC_CLIENT_MAX 64   // longest clientId kept, with its NUL
+
+typedef struct {
+    long seq;           // "q" of the last message packed
+    int keyframe_in;    // deltas left before the next periodic keyframe
+    int need_keyframe;  // first message, or the receiver asked
+    int sent_length;    // body length the receiver has after our last message
+    Segment sent_head;
+    int plain_body;     // keyframes as {x,y} arrays (benchmarks, debugging)
+    int wrote_keyframe; // the last sync_write was a keyframe: whole state
+    long keyframes, deltas;
+} SyncSender;
+
+typedef enum {
+    SYNC_IGNORED = 0,   // nothing to apply (no snake data, or waiting for a keyframe)
+    SYNC_APPLIED = 1,   // body now holds the sender's snake
+    SYNC_RESYNC = 2     // a message was missed; ask the sender for a keyframe
+} SyncResult;
+
+typedef struct {
+    SnakeBody body;     // mirror of the sender's snake
+    long last_seq;
+    int synced;         // have a keyframe and no gap since
+    long resync_asked;  // seq at which we last asked for a keyframe, 0 if not waiting
+    char peer[SYNC_CLIENT_MAX]; // clientId being mirrored, "" until the first snake
+    long keyframes, deltas, gaps;
+    long foreign;       // snake messages from other clients, ignored
+} SyncReceiver;
+
+void sync_sender_reset(SyncSender* s);
+void sync_request_keyframe(SyncSender* s);
+// Writes this tick's game data object straight into out, with "fx"/"fy"
+// added when food is given. No JSON tree is built, so nothing is allocated.
+// Returns the length (without a NUL), or -1 if cap was too small. A delta
+// that never reaches the receiver breaks its chain, so a caller that fails
+// to send one should call sync_request_keyframe.
+#define SYNC_TEXT_MAX 4096 // fits a plain {x,y} body of MAX_LEN segments
+int sync_write(SyncSender* s, const SnakeBody* b, const Segment* food, char* out, size_t cap);
+
+// The packed direction string on its own. Encode needs room for
+// SYNC_DIRS_MAX bytes and returns -1 if the body is not a chain of unit
+// steps. Decode rebuilds length segments from head into b and returns -1
+// on a malformed string.
+#define SYNC_DIRS_MAX ((MAX_LEN - 1 + 2) / 3 + 1)
+int sync_encode_dirs(const SnakeBody* b, char* out);
+int sync_decode_dirs(SnakeBody* b, Segment head, int length, const char* dirs);
+
+// One decoded "game" data object. The caller points body and foods at its
+// own arrays; the decoders never write past body_max / foods_max.
+#define SYNC_F_Q      (1u << 0)
+#define SYNC_F_HX     (1u << 1)
+#define SYNC_F_HY     (1u << 2)
+#define SYNC_F_G      (1u << 3)
+#define SYNC_F_N      (1u << 4)
+#define SYNC_F_BD     (1u << 5)
+#define SYNC_F_BODY   (1u << 6)
+#define SYNC_F_FOODS  (1u << 7)
+#define SYNC_F_FX     (1u << 8)
+#define SYNC_F_FY     (1u << 9)
+#define SYNC_F_W      (1u << 10)
+#define SYNC_F_H      (1u << 11)
+#define SYNC_F_RESYNC (1u << 12)
+
+typedef struct {
+    unsigned fields;    // SYNC_F_* of the keys that were present
+    char client[SYNC_CLIENT_MAX]; // sender's clientId, "" if not known
+    long q;
+    int hx, hy, g, n;
+    char bd[SYNC_DIRS_MAX];
+    Segment* body;
+    int body_max, body_count;
+    Segment* foods;
+    int foods_max, food_count;
+    int fx, fy, w, h;
+} SyncMessage;
+
+// Decodes a whole {"cmd": "game", ..., "data": {...}} line straight into m
+// without building a tree. Returns 1 on success and 0 for anything it does
+// not know: another cmd, an unexpected key or type, a clientId longer than
+// SYNC_CLIENT_MAX - 1, or more segments or foods than fit. The caller then
+// parses the line the normal way.
+int sync_decode_line(const char* line, size_t len, SyncMessage* m);
+// The same fields taken from an already parsed data object and the
+// envelope's clientId (NULL if none); arrays that do not fit are cut short
+void sync_message_from_json(const char* clientId, json_t* data, SyncMessage* m);
+
+// What a data object means for the sender's state, judged from its keys
+// without decoding the values: a keyframe (or a Royale arena size) is the
+// whole state and makes older ones useless, a delta only builds on what
+// came before, and anything else (a resync request, unknown keys) must
+// always be delivered.
+typedef enum {
+    SYNC_DATA_OTHER = 0,
+    SYNC_DATA_DELTA = 1,
+    SYNC_DATA_STATE = 2
+} SyncDataKind;
+SyncDataKind sync_data_kind(const char* data, size_t len);
+
+void sync_receiver_reset(SyncReceiver* r);
+SyncResult sync_apply(SyncReceiver* r, const SyncMessage* m);
+// Copies the mirrored body head first into segs; returns the count
+int sync_body_segments(const SyncReceiver* r, Segment* segs);
+
+#endif //SNAKESYNC_H
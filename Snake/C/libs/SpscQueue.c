@@ -0,0 +1,85 @@
+#include "SpscQueue.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+// head is written only by the consumer and tail only by the producer; each
+// sits on its own cache line, next to the cached copy of the other side's
+// index, so neither thread bounces the other's line on every item.
+struct SpscQueue {
+    _Alignas(64) atomic_size_t head; // next slot to pop
+    size_t tail_cache;               // consumer's last look at tail
+
+    _Alignas(64) atomic_size_t tail; // next slot to push
+    size_t head_cache;               // producer's last look at head
+
+    _Alignas(64) size_t mask;
+    size_t item_size;
+    unsigned char *items;
+};
+
+SpscQueue *spsc_queue_create(size_t capacity, size_t item_size) {
+    if (capacity == 0 || item_size == 0) return NULL;
+
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+
+    SpscQueue *q = (SpscQueue *)aligned_alloc(64, sizeof(SpscQueue));
+    if (!q) return NULL;
+    memset(q, 0, sizeof(*q));
+
+    q->items = (unsigned char *)malloc(cap * item_size);
+    if (!q->items) {
+        free(q);
+        return NULL;
+    }
+
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    q->mask = cap - 1;
+    q->item_size = item_size;
+    return q;
+}
+
+void spsc_queue_destroy(SpscQueue *q) {
+    if (!q) return;
+    free(q->items);
+    free(q);
+}
+
+int spsc_queue_push(SpscQueue *q, const void *item) {
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+    if (tail - q->head_cache > q->mask) {
+        q->head_cache = atomic_load_explicit(&q->head, memory_order_acquire);
+        if (tail - q->head_cache > q->mask) return 0; // full
+    }
+
+    memcpy(q->items + (tail & q->mask) * q->item_size, item, q->item_size);
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+int spsc_queue_pop(SpscQueue *q, void *out) {
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+    if (head == q->tail_cache) {
+        q->tail_cache = atomic_load_explicit(&q->tail, memory_order_acquire);
+        if (head == q->tail_cache) return 0; // empty
+    }
+
+    memcpy(out, q->items + (head & q->mask) * q->item_size, q->item_size);
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return 1;
+}
+
+size_t spsc_queue_size(const SpscQueue *q) {
+    size_t tail = atomic_load_explicit(&((SpscQueue *)q)->tail, memory_order_acquire);
+    size_t head = atomic_load_explicit(&((SpscQueue *)q)->head, memory_order_acquire);
+    return tail - head;
+}
+
+size_t spsc_queue_capacity(const SpscQueue *q) {
+    return q->mask + 1;
+}
@@ -0,0 +1,26 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <stddef.h>
+
+// Bounded lock-free ring for exactly one producer thread and one consumer
+// thread. Items are copied in and out by value; a push never blocks and
+// fails when the ring is full, so the producer decides what to drop.
+
+typedef struct SpscQueue SpscQueue;
+
+/* capacity is rounded up to a power of two. Returns NULL on error. */
+SpscQueue *spsc_queue_create(size_t capacity, size_t item_size);
+void spsc_queue_destroy(SpscQueue *q);
+
+/* Producer side. Returns 1 if the item was queued, 0 if the ring is full. */
+int spsc_queue_push(SpscQueue *q, const void *item);
+
+/* Consumer side. Returns 1 and copies the oldest item into out, or 0 if empty. */
+int spsc_queue_pop(SpscQueue *q, void *out);
+
+/* Items queued right now; exact only from the consumer's point of view. */
+size_t spsc_queue_size(const SpscQueue *q);
+size_t spsc_queue_capacity(const SpscQueue *q);
+
+#endif //SPSCQUEUE_H
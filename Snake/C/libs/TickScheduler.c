@@ -0,0 +1,142 @@
+#include "TickScheduler.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#define NSEC_PER_SEC 1000000000L
+
+static void timespec_add_ns(struct timespec *t, long ns) {
+    t->tv_sec += ns / NSEC_PER_SEC;
+    t->tv_nsec += ns % NSEC_PER_SEC;
+    if (t->tv_nsec >= NSEC_PER_SEC) {
+        t->tv_nsec -= NSEC_PER_SEC;
+        t->tv_sec++;
+    }
+}
+
+static long timespec_diff_ns(const struct timespec *a, const struct timespec *b) {
+    return (a->tv_sec - b->tv_sec) * NSEC_PER_SEC + (a->tv_nsec - b->tv_nsec);
+}
+
+// Arms the one-shot timerfd at the next deadline; a deadline already in the
+// past fires at once, which is how catch-up ticks get delivered.
+static void arm_timer(TickScheduler *ts) {
+    if (ts->fd < 0) return;
+
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_value = ts->next;
+    if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+        its.it_value.tv_nsec = 1; // all zero would disarm it
+    timerfd_settime(ts->fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+void tick_scheduler_init(TickScheduler *ts, int rate, TickPolicy policy) {
+    memset(ts, 0, sizeof(*ts));
+    ts->fd = -1;
+    ts->policy = policy;
+    ts->max_catch_up = 3;
+    tick_scheduler_set_rate(ts, rate);
+}
+
+// Changes the rate and restarts the schedule from now, so the first tick at
+// the new rate is due immediately.
+void tick_scheduler_set_rate(TickScheduler *ts, int rate) {
+    if (rate < 1) rate = 1;
+    ts->rate = rate;
+    ts->period_ns = NSEC_PER_SEC / rate;
+    clock_gettime(CLOCK_MONOTONIC, &ts->next);
+    arm_timer(ts);
+}
+
+// Records how late the due tick started and moves on to the next deadline
+static void start_tick(TickScheduler *ts) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    long late_ns = timespec_diff_ns(&now, &ts->next);
+    if (late_ns < 0) late_ns = 0;
+
+    long late_us = late_ns / 1000;
+    ts->late_us[ts->ticks % TICK_HISTORY] = late_us;
+    ts->late_last_us = late_us;
+    ts->late_total_us += late_us;
+    if (late_us > ts->late_max_us) ts->late_max_us = late_us;
+    ts->ticks++;
+
+    timespec_add_ns(&ts->next, ts->period_ns);
+
+    // More whole periods behind than the policy allows: skip those deadlines
+    long behind = late_ns / ts->period_ns;
+    long allowed = (ts->policy == TICK_CATCH_UP) ? ts->max_catch_up : 0;
+    if (behind > allowed) {
+        long skip = behind - allowed;
+        timespec_add_ns(&ts->next, skip * ts->period_ns);
+        ts->dropped += skip;
+    }
+}
+
+// Sleeps until the next tick is due.
+void tick_scheduler_wait(TickScheduler *ts) {
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts->next, NULL) == EINTR)
+        ;
+    start_tick(ts);
+}
+
+// Returns a non-blocking timerfd that becomes readable when a tick is due,
+// or -1 on error.
+int tick_scheduler_open_fd(TickScheduler *ts) {
+    if (ts->fd >= 0) return ts->fd;
+
+    ts->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (ts->fd < 0) return -1;
+
+    arm_timer(ts);
+    return ts->fd;
+}
+
+// Call when the timerfd is readable. Returns 1 if a tick should run now.
+int tick_scheduler_on_timer(TickScheduler *ts) {
+    uint64_t expirations;
+    if (ts->fd < 0) return 0;
+    if (read(ts->fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        return 0;
+
+    start_tick(ts);
+    arm_timer(ts);
+    return 1;
+}
+
+void tick_scheduler_close_fd(TickScheduler *ts) {
+    if (ts->fd < 0) return;
+    close(ts->fd);
+    ts->fd = -1;
+}
+
+double tick_scheduler_avg_late_us(const TickScheduler *ts) {
+    return ts->ticks ? ts->late_total_us / ts->ticks : 0;
+}
+
+static int compare_long(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+// Lateness that percentile% of the last TICK_HISTORY ticks stayed within
+long tick_scheduler_recent_late_us(const TickScheduler *ts, int percentile) {
+    int n = ts->ticks < TICK_HISTORY ? (int)ts->ticks : TICK_HISTORY;
+    if (n == 0) return 0;
+
+    long sorted[TICK_HISTORY];
+    memcpy(sorted, ts->late_us, (size_t)n * sizeof(long));
+    qsort(sorted, (size_t)n, sizeof(long), compare_long);
+
+    int at = (n * percentile + 99) / 100 - 1; // nearest rank
+    if (at < 0) at = 0;
+    if (at >= n) at = n - 1;
+    return sorted[at];
+}
@@ -0,0 +1,50 @@
+#ifndef TICKSCHEDULER_H
+#define TICKSCHEDULER_H
+
+#include <time.h>
+
+// Fixed-rate tick pacing on absolute CLOCK_MONOTONIC deadlines. Tick n is
+// due at start + n * period no matter how long the work between ticks took,
+// so two clients running the same rate stay in step instead of drifting by
+// their draw and network time.
+//
+// Two ways to wait: tick_scheduler_wait() sleeps in clock_nanosleep, or
+// tick_scheduler_open_fd() gives a timerfd armed at the same deadline for an
+// epoll loop, which then calls tick_scheduler_on_timer() when it fires.
+
+#define TICK_HISTORY 64 // lateness samples kept for the last ticks
+
+typedef enum {
+    TICK_CATCH_UP, // run missed ticks back to back, at most max_catch_up of them
+    TICK_DROP      // skip missed ticks and wait for the next deadline
+} TickPolicy;
+
+typedef struct {
+    int rate;              // ticks per second
+    long period_ns;
+    TickPolicy policy;
+    int max_catch_up;
+
+    struct timespec next;  // absolute deadline of the next tick
+    int fd;                // timerfd, or -1 when sleeping instead
+
+    long ticks;            // ticks started
+    long dropped;          // deadlines skipped by the policy
+
+    // How late each tick started relative to its deadline
+    long late_us[TICK_HISTORY];
+    long late_last_us;
+    long late_max_us;
+    double late_total_us;
+} TickScheduler;
+
+void tick_scheduler_init(TickScheduler *ts, int rate, TickPolicy policy);
+void tick_scheduler_set_rate(TickScheduler *ts, int rate);
+void tick_scheduler_wait(TickScheduler *ts);
+int tick_scheduler_open_fd(TickScheduler *ts);
+int tick_scheduler_on_timer(TickScheduler *ts);
+void tick_scheduler_close_fd(TickScheduler *ts);
+double tick_scheduler_avg_late_us(const TickScheduler *ts);
+long tick_scheduler_recent_late_us(const TickScheduler *ts, int percentile);
+
+#endif //TICKSCHEDULER_H
@@ -374,6 +374,40 @@ json_t *json_loadfd(int input, size_t flags, json_error_t *error) JSON_ATTRS(war
 json_t *json_load_file(const char *path, size_t flags, json_error_t *error) JSON_ATTRS(warn_unused_result);
 json_t *json_load_callback(json_load_callback_t callback, void *data, size_t flags, json_error_t *error) JSON_ATTRS(warn_unused_result);
 
+/* streaming decoding: the json_load* lexer reports each token instead of
+   building a tree. Strings and keys are only valid during the callback.
+   JSON_REJECT_DUPLICATES is not checked. */
+
+typedef enum {
+    JSON_SAX_OBJECT_START,
+    JSON_SAX_OBJECT_END,
+    JSON_SAX_ARRAY_START,
+    JSON_SAX_ARRAY_END,
+    JSON_SAX_KEY,
+    JSON_SAX_STRING,
+    JSON_SAX_INTEGER,
+    JSON_SAX_REAL,
+    JSON_SAX_TRUE,
+    JSON_SAX_FALSE,
+    JSON_SAX_NULL
+} json_sax_event_t;
+
+typedef struct {
+    const char *string;   /* JSON_SAX_KEY, JSON_SAX_STRING */
+    size_t length;
+    json_int_t integer;   /* JSON_SAX_INTEGER */
+    double real;          /* JSON_SAX_REAL */
+} json_sax_value_t;
+
+/* Return 0 to go on; any other value stops decoding and is returned by
+   json_sax_loadb. */
+typedef int (*json_sax_callback_t)(json_sax_event_t event, const json_sax_value_t *value, void *data);
+
+/* Returns 0 when the whole input was decoded, -1 on a syntax error (error
+   is set; events already delivered describe a broken document), or the
+   value a callback stopped with. */
+int json_sax_loadb(const char *buffer, size_t buflen, size_t flags, json_sax_callback_t callback, void *data, json_error_t *error);
+
 
 /* encoding */
 
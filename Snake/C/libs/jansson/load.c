@@ -1011,6 +1011,206 @@ json_t *json_loadb(const char *buffer, size_t buflen, size_t flags, json_error_t
     return result;
 }
 
+/*** streaming parser ***/
+
+static int sax_value(lex_t *lex, size_t flags, json_sax_callback_t callback, void *data, json_error_t *error);
+
+static int sax_object(lex_t *lex, size_t flags, json_sax_callback_t callback, void *data, json_error_t *error)
+{
+    json_sax_value_t value;
+    int rc;
+
+    memset(&value, 0, sizeof(value));
+    if((rc = callback(JSON_SAX_OBJECT_START, &value, data)))
+        return rc;
+
+    lex_scan(lex, error);
+    if(lex->token != '}') {
+        while(1) {
+            if(lex->token != TOKEN_STRING) {
+                error_set(error, lex, json_error_invalid_syntax, "string or '}' expected");
+                return -1;
+            }
+
+            value.string = lex->value.string.val;
+            value.length = lex->value.string.len;
+            if(memchr(value.string, '\0', value.length)) {
+                error_set(error, lex, json_error_null_byte_in_key, "NUL byte in object key not supported");
+                return -1;
+            }
+            if((rc = callback(JSON_SAX_KEY, &value, data)))
+                return rc;
+
+            lex_scan(lex, error);
+            if(lex->token != ':') {
+                error_set(error, lex, json_error_invalid_syntax, "':' expected");
+                return -1;
+            }
+
+            lex_scan(lex, error);
+            if((rc = sax_value(lex, flags, callback, data, error)))
+                return rc;
+
+            lex_scan(lex, error);
+            if(lex->token != ',')
+                break;
+
+            lex_scan(lex, error);
+        }
+
+        if(lex->token != '}') {
+            error_set(error, lex, json_error_invalid_syntax, "'}' expected");
+            return -1;
+        }
+    }
+
+    memset(&value, 0, sizeof(value));
+    return callback(JSON_SAX_OBJECT_END, &value, data);
+}
+
+static int sax_array(lex_t *lex, size_t flags, json_sax_callback_t callback, void *data, json_error_t *error)
+{
+    json_sax_value_t value;
+    int rc;
+
+    memset(&value, 0, sizeof(value));
+    if((rc = callback(JSON_SAX_ARRAY_START, &value, data)))
+        return rc;
+
+    lex_scan(lex, error);
+    if(lex->token != ']') {
+        while(lex->token) {
+            if((rc = sax_value(lex, flags, callback, data, error)))
+                return rc;
+
+            lex_scan(lex, error);
+            if(lex->token != ',')
+                break;
+
+            lex_scan(lex, error);
+        }
+
+        if(lex->token != ']') {
+            error_set(error, lex, json_error_invalid_syntax, "']' expected");
+            return -1;
+        }
+    }
+
+    return callback(JSON_SAX_ARRAY_END, &value, data);
+}
+
+static int sax_value(lex_t *lex, size_t flags, json_sax_callback_t callback, void *data, json_error_t *error)
+{
+    json_sax_value_t value;
+    int rc;
+
+    lex->depth++;
+    if(lex->depth > JSON_PARSER_MAX_DEPTH) {
+        error_set(error, lex, json_error_stack_overflow, "maximum parsing depth reached");
+        return -1;
+    }
+
+    memset(&value, 0, sizeof(value));
+    switch(lex->token) {
+        case TOKEN_STRING:
+            value.string = lex->value.string.val;
+            value.length = lex->value.string.len;
+            if(!(flags & JSON_ALLOW_NUL)) {
+                if(memchr(value.string, '\0', value.length)) {
+                    error_set(error, lex, json_error_null_character, "\\u0000 is not allowed without JSON_ALLOW_NUL");
+                    return -1;
+                }
+            }
+            rc = callback(JSON_SAX_STRING, &value, data);
+            break;
+
+        case TOKEN_INTEGER:
+            value.integer = lex->value.integer;
+            rc = callback(JSON_SAX_INTEGER, &value, data);
+            break;
+
+        case TOKEN_REAL:
+            value.real = lex->value.real;
+            rc = callback(JSON_SAX_REAL, &value, data);
+            break;
+
+        case TOKEN_TRUE:
+            rc = callback(JSON_SAX_TRUE, &value, data);
+            break;
+
+        case TOKEN_FALSE:
+            rc = callback(JSON_SAX_FALSE, &value, data);
+            break;
+
+        case TOKEN_NULL:
+            rc = callback(JSON_SAX_NULL, &value, data);
+            break;
+
+        case '{':
+            rc = sax_object(lex, flags, callback, data, error);
+            break;
+
+        case '[':
+            rc = sax_array(lex, flags, callback, data, error);
+            break;
+
+        case TOKEN_INVALID:
+            error_set(error, lex, json_error_invalid_syntax, "invalid token");
+            return -1;
+
+        default:
+            error_set(error, lex, json_error_invalid_syntax, "unexpected token");
+            return -1;
+    }
+
+    if(rc)
+        return rc;
+
+    lex->depth--;
+    return 0;
+}
+
+int json_sax_loadb(const char *buffer, size_t buflen, size_t flags, json_sax_callback_t callback, void *data, json_error_t *error)
+{
+    lex_t lex;
+    buffer_data_t stream_data;
+    int rc;
+
+    jsonp_error_init(error, "<buffer>");
+
+    if (buffer == NULL || callback == NULL) {
+        error_set(error, NULL, json_error_invalid_argument, "wrong arguments");
+        return -1;
+    }
+
+    stream_data.data = buffer;
+    stream_data.pos = 0;
+    stream_data.len = buflen;
+
+    if(lex_init(&lex, buffer_get, flags, (void *)&stream_data))
+        return -1;
+
+    lex.depth = 0;
+    lex_scan(&lex, error);
+    if(!(flags & JSON_DECODE_ANY) && lex.token != '[' && lex.token != '{') {
+        error_set(error, &lex, json_error_invalid_syntax, "'[' or '{' expected");
+        rc = -1;
+    }
+    else {
+        rc = sax_value(&lex, flags, callback, data, error);
+        if(!rc && !(flags & JSON_DISABLE_EOF_CHECK)) {
+            lex_scan(&lex, error);
+            if(lex.token != TOKEN_EOF) {
+                error_set(error, &lex, json_error_end_of_input_expected, "end of file expected (%i)", lex.token);
+                rc = -1;
+            }
+        }
+    }
+
+    lex_close(&lex);
+    return rc;
+}
+
 json_t *json_loadf(FILE *input, size_t flags, json_error_t *error)
 {
     lex_t lex;
@@ -5,10 +5,16 @@
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <sys/epoll.h>
 
 #include "libs/jansson/jansson.h"
 #include "libs/MultiplayerApi.h"
 #include "libs/GameLogic.h"
+#include "libs/RoomScheduler.h"
+#include "libs/TickScheduler.h"
+#include "libs/EventLoop.h"
+#include "libs/Bench.h"
+#include "libs/SnakeSync.h"
 
 // -------------------------------
 // Main
@@ -16,6 +22,81 @@
 
 char currentSessionId[64] = {0};
 
+// The match this terminal is playing; the network callback writes the
+// opponent into it. The socket is pumped from the main loop, so events run
+// on the main thread between ticks and the world never changes mid-draw.
+static GameWorld world;
+
+// Our snake goes out as deltas, the opponent's is rebuilt from theirs
+static SyncSender sync_out;
+static SyncReceiver sync_in;
+
+static void reset_online_sync() {
+    sync_sender_reset(&sync_out);
+    sync_receiver_reset(&sync_in);
+}
+
+static void apply_game_message(const SyncMessage *msg, MultiplayerApi *api) {
+	// 1. Sync Snake (keyframe or delta, see SnakeSync.h)
+	if (msg->fields & SYNC_F_RESYNC) {
+		sync_request_keyframe(&sync_out);
+	}
+	SyncResult synced = sync_apply(&sync_in, msg);
+	if (synced == SYNC_APPLIED) {
+		Segment segs[MAX_LEN];
+		int count = sync_body_segments(&sync_in, segs);
+		world_set_body(&world, 1, segs, count);
+	} else if (synced == SYNC_RESYNC) {
+		static const char req[] = "{\"resync\":true}";
+		mp_api_game_text(api, req, sizeof(req) - 1);
+	}
+
+	// 2. Sync Map Size (Royale)
+	if ((msg->fields & SYNC_F_W) && (msg->fields & SYNC_F_H)) {
+		world_set_arena(&world, msg->w, msg->h);
+	}
+
+	// 3. Sync Food (Single OR Array for Royale)
+	if (!is_host) {
+		int xs[MAX_FOOD], ys[MAX_FOOD];
+		if (msg->fields & SYNC_F_FOODS) {
+			int count = msg->food_count < MAX_FOOD ? msg->food_count : MAX_FOOD;
+			for (int i = 0; i < count; i++) {
+				xs[i] = msg->foods[i].x;
+				ys[i] = msg->foods[i].y;
+			}
+			world_set_food(&world, xs, ys, count);
+		} else if ((msg->fields & SYNC_F_FX) && (msg->fields & SYNC_F_FY)) {
+			// Fallback for standard 1v1 mode
+			xs[0] = msg->fx;
+			ys[0] = msg->fy;
+			world_set_food(&world, xs, ys, 1);
+		}
+	}
+}
+
+// Game lines of the known shape are decoded straight into stack arrays;
+// anything else goes on to json_loadb and on_multiplayer_event
+static int on_game_line(const char *line, size_t len, void *user_data) {
+	Segment body[MAX_LEN], foods[MAX_FOOD];
+	SyncMessage msg = { .body = body, .body_max = MAX_LEN, .foods = foods, .foods_max = MAX_FOOD };
+
+	if (!sync_decode_line(line, len, &msg)) return 0;
+	apply_game_message(&msg, (MultiplayerApi *)user_data);
+	return 1;
+}
+
+// After a stall only each sender's newest keyframe and what follows it
+// is decoded; see mp_api_set_conflation
+static MpApiMsgKind classify_game_data(const char *data, size_t len, void *user_data) {
+	(void)user_data;
+	switch (sync_data_kind(data, len)) {
+		case SYNC_DATA_STATE: return MP_API_MSG_SNAPSHOT;
+		case SYNC_DATA_DELTA: return MP_API_MSG_UPDATE;
+		default: return MP_API_MSG_EVENT;
+	}
+}
+
 static void on_multiplayer_event(
     const char *event,
     int64_t messageId,
@@ -34,54 +115,60 @@ static void on_multiplayer_event(
 		}
 
 		if (strcmp(event, "game") == 0) {
-        	// 1. Sync Snake
-        	json_t *body = json_object_get(data, "body");
-        		if (json_is_array(body)) {
-            		snake2_length = json_array_size(body);
-            		for (size_t i = 0; i < snake2_length && i < MAX_LEN; i++) {
-                		json_t *seg = json_array_get(body, i);
-                		snake2[i].x = json_integer_value(json_object_get(seg, "x"));
-                		snake2[i].y = json_integer_value(json_object_get(seg, "y"));
-            		}
-        		}
-
-        		// 2. Sync Map Size (Royale)
-        		json_t *w = json_object_get(data, "w");
-        		json_t *h = json_object_get(data, "h");
-        		if (w && h) {
-            		currentWidth = json_integer_value(w);
-            		currentHeight = json_integer_value(h);
-        		}
-
-        		// 3. Sync Food (Single OR Array for Royale)
-				if (!is_host) {
-	    			json_t *foods = json_object_get(data, "foods"); // Look for the array
-	    			if (json_is_array(foods)) {
-	        			active_food_count = json_array_size(foods);
-	        			for (size_t i = 0; i < active_food_count && i < 50; i++) {
-	            			json_t *f = json_array_get(foods, i);
-	            			foodX_array[i] = json_integer_value(json_object_get(f, "x"));
-	            			foodY_array[i] = json_integer_value(json_object_get(f, "y"));
-	        			}
-	    			} else {
-	        			// Fallback for standard 1v1 mode
-	        			json_t *fx = json_object_get(data, "fx");
-	        			json_t *fy = json_object_get(data, "fy");
-	        			if (fx && fy) {
-	            			foodX = json_integer_value(fx);
-	            			foodY = json_integer_value(fy);
-	            			foodX_array[0] = foodX; 
-	            			foodY_array[0] = foodY; 
-	            			active_food_count = 1;
-	        			}
-	    			}
-				}
-			}
+			Segment body[MAX_LEN], foods[MAX_FOOD];
+			SyncMessage msg = { .body = body, .body_max = MAX_LEN, .foods = foods, .foods_max = MAX_FOOD };
+			sync_message_from_json(clientId, data, &msg);
+			apply_game_message(&msg, (MultiplayerApi *)user_data);
+		}
     		if (strData)
 				free(strData);
     /* data är ett json_t* (object); anropa json_incref(data) om du vill spara det efter callbacken */
 }
 
+// Set by the event loop handlers, checked once per wakeup
+static int tick_due = 0;
+static int keys_arrived = 0;
+static EventLoop *loop_for_network = NULL;
+static int network_fd = -1; // registered in the loop, -1 if none
+
+static void on_tick_timer(int fd, unsigned int events, void *user_data) {
+    if (tick_scheduler_on_timer((TickScheduler *)user_data)) {
+        tick_due = 1;
+    }
+}
+
+// Runs the multiplayer listeners for everything the server has sent
+static void on_network(int fd, unsigned int events, void *user_data) {
+    MultiplayerApi *api = (MultiplayerApi *)user_data;
+    if (mp_api_process(api, 0) < 0) {
+        // The server hung up and the api has closed the socket already
+        event_loop_remove(loop_for_network, fd);
+        network_fd = -1;
+        connection_lost = 1;
+        currentSessionId[0] = '\0';
+        if (current_state == STATE_MULTIPLAYER_HOST) {
+            current_state = STATE_MENU; // nobody can join a session that is gone
+        }
+    }
+}
+
+static void on_stdin(int fd, unsigned int events, void *user_data) {
+    int n;
+    // Game states queue their turns as each chunk comes in
+    while ((n = input_fill()) > 0) {
+        queueGameKeys(&world);
+    }
+    if (n < 0) {
+        event_loop_remove((EventLoop *)user_data, fd); // stdin closed
+    }
+    keys_arrived = 1;
+}
+
+// States that only wait for a key run as soon as one arrives
+static int reacts_to_keys(GameState state) {
+    return state == STATE_MENU || state == STATE_GAME_OVER || state == STATE_ROYALE_SPECTATOR;
+}
+
 int main_host(MultiplayerApi* api)
 {
     char *session = NULL;
@@ -96,6 +183,7 @@ int main_host(MultiplayerApi* api)
 
 	if (rc == MP_API_OK) {
         is_host = 1; // Mark as host
+        connection_lost = 0;
         printf("Du hostar session: %s\n", session);
     }  
   
@@ -165,6 +253,7 @@ int main_join(MultiplayerApi* api, const char* sessionId)
 		printf("Ansluten till session: %s (clientId: %s)\n", joinedSession, joinedClientId);
 		/* joinData kan innehålla status eller annan info */
 		is_host = 0;
+		connection_lost = 0;
 		if (joinData) json_decref(joinData);
 		free(joinedSession);
 		free(joinedClientId);
@@ -177,9 +266,76 @@ int main_join(MultiplayerApi* api, const char* sessionId)
 	return 0;
 }
 
-int main() {
+/* Headless server: ./Snake --server [rooms] [workers] [ticks] [tick rate]
+   Steps bot-driven rooms on every core; tick rate 0 runs unthrottled. */
+int main_server(int argc, char **argv)
+{
+	int rooms = argc > 0 ? atoi(argv[0]) : 1000;
+	int workers = argc > 1 ? atoi(argv[1]) : 0;
+	int ticks = argc > 2 ? atoi(argv[2]) : 100;
+	int rate = argc > 3 ? atoi(argv[3]) : 10;
+
+	RoomScheduler *sched = room_scheduler_create(rooms, workers, rate);
+	if (!sched) {
+		fprintf(stderr, "Kunde inte starta %d rum\n", rooms);
+		return 1;
+	}
+
+	TickScheduler ticker;
+	tick_scheduler_init(&ticker, rate, TICK_CATCH_UP);
+	double total_ms = 0;
+
+	for (int t = 0; t < ticks; t++) {
+		RoomTickStats st;
+		room_scheduler_tick(sched, &st);
+		total_ms += st.wall_ms;
+
+		printf("tick %ld: %.3f ms", st.tick, st.wall_ms);
+		if (st.budget_ms > 0)
+			printf(" (%.1f%% of %.0f ms)", 100.0 * st.wall_ms / st.budget_ms, st.budget_ms);
+		printf(" |");
+		for (int k = 0; k < st.worker_count; k++) {
+			if (st.budget_ms > 0)
+				printf(" w%d %.1f%%", k, st.workers[k].budget_pct);
+			else
+				printf(" w%d %.3fms", k, st.workers[k].busy_ms);
+			if (st.workers[k].rooms_stolen)
+				printf("(+%d)", st.workers[k].rooms_stolen);
+		}
+		printf("\n");
+
+		if (rate > 0)
+			tick_scheduler_wait(&ticker);
+	}
+
+	long matches = 0;
+	for (int i = 0; i < room_scheduler_room_count(sched); i++)
+		matches += room_scheduler_room(sched, i)->matches;
+
+	printf("%d rooms x %d ticks: %.0f room-ticks/s while stepping, %ld matches finished\n",
+	       rooms, ticks, total_ms > 0 ? (double)rooms * ticks / (total_ms / 1000.0) : 0.0, matches);
+	if (rate > 0)
+		printf("tick start lateness: avg %.0f us, p95 of the last %d ticks %ld us, max %ld us, %ld ticks dropped\n",
+		       tick_scheduler_avg_late_us(&ticker), TICK_HISTORY,
+		       tick_scheduler_recent_late_us(&ticker, 95), ticker.late_max_us, ticker.dropped);
+
+	room_scheduler_destroy(sched);
+	return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--server") == 0) {
+        return main_server(argc - 2, argv + 2);
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        return main_bench(argc - 2, argv + 2);
+    }
+
     srand(time(NULL));
 
+    open_highscores();
+    atexit(close_highscores);
+
     enableRawMode();
     atexit(disableRawMode);
 
@@ -190,56 +346,73 @@ int main() {
         return 1;
     }
 
-    int listener_id = mp_api_listen(api, on_multiplayer_event, NULL);
+    mp_api_set_delivery(api, MP_API_DELIVER_PUMP);
+    mp_api_set_send_queue(api, 8, MP_API_SEND_COALESCE);
+    mp_api_set_line_handler(api, on_game_line, api);
+    mp_api_set_conflation(api, classify_game_data, NULL);
+    int listener_id = mp_api_listen(api, on_multiplayer_event, api);
 	int menu_needs_redraw = 1;
 
-    json_t *gameData = json_object();
-    json_object_set_new(gameData, "x", json_integer(12));
-    json_object_set_new(gameData, "y", json_integer(34));
-    json_object_set_new(gameData, "dir", json_string("right"));
-    
     GameState last_active_mode = STATE_SINGLEPLAYER;
 
+    // Every state ticks on absolute deadlines at its own rate. The loop
+    // sleeps in epoll until the tick timer fires or a key arrives.
+    TickScheduler ticker;
+    GameState paced_state = current_state;
+    tick_scheduler_init(&ticker, tick_rate_for_state(current_state), TICK_CATCH_UP);
+
+    EventLoop *loop = event_loop_create();
+    if (!loop || tick_scheduler_open_fd(&ticker) < 0) {
+        return 1;
+    }
+    event_loop_add(loop, ticker.fd, EPOLLIN, on_tick_timer, &ticker);
+    event_loop_add(loop, STDIN_FILENO, EPOLLIN, on_stdin, loop);
+    loop_for_network = loop;
+
     // --- MAIN PROGRAM LOOP ---
     while (1) {
+        if (current_state != paced_state) {
+            paced_state = current_state;
+            tick_scheduler_set_rate(&ticker, tick_rate_for_state(current_state));
+        }
+
+        // The socket exists once hosting or joining has connected, and a
+        // later host or join after a hangup connects a new one
+        if (mp_api_fd(api) != network_fd) {
+            if (network_fd >= 0) event_loop_remove(loop, network_fd);
+            network_fd = mp_api_fd(api);
+            if (network_fd >= 0) event_loop_add(loop, network_fd, EPOLLIN, on_network, api);
+        }
+
+        tick_due = 0;
+        keys_arrived = 0;
+        if (event_loop_run_once(loop, -1) < 0) {
+            perror("epoll_wait"); // would fail again at once; don't spin
+            goto cleanup;
+        }
+
+        // Game states take their queued turns on the next tick
+        if (!tick_due && !(keys_arrived && reacts_to_keys(current_state))) {
+            continue;
+        }
+
         switch (current_state) {
             case STATE_MENU:
     		if (menu_needs_redraw) {
         		drawMenu();
         	menu_needs_redraw = 0; // Stop drawing until something changes
     		}
-    		pollMenuInput(); 
-    		usleep(50000); 
+    		pollMenuInput(&world); 
     		break;
 
             case STATE_SINGLEPLAYER:
                 last_active_mode = STATE_SINGLEPLAYER;
-                runSinglePlayerGameTick(api, gameData);
-                usleep(100000);
+                runSinglePlayerGameTick(&world);
             break;
 
             case STATE_MULTIPLAYER_LOCAL:
     			last_active_mode = STATE_MULTIPLAYER_LOCAL;
-    			pollLocalMultiplayerInput();
-    
-    			// Move both
-    			for (int i = snake_length - 1; i > 0; i--) snake[i] = snake[i - 1];
-    			snake[0].x += dirX; snake[0].y += dirY;
-    
-    			for (int i = snake2_length - 1; i > 0; i--) snake2[i] = snake2[i - 1];
-    			snake2[0].x += dirX2; snake2[0].y += dirY2;
-
-    			int result = checkMultiplayerCollision();
-    			if (result > 0) {
-    			    current_state = STATE_GAME_OVER;
-    			}
-
-    			// Food check for both...
-    			if (snake[0].x == foodX && snake[0].y == foodY) { snake_length++; spawnFood(); }
-    			if (snake2[0].x == foodX && snake2[0].y == foodY) { snake2_length++; spawnFood(); }
-
-    			draw(); // Make sure draw() is updated to loop through snake2 as well!
-    			usleep(100000);
+    			runLocalMultiplayerTick(&world);
     		break;
 
 			// --- JOIN STATE (Restored) ---
@@ -252,7 +425,8 @@ int main() {
                     printf("Joining %s...\n", joinCode);
                     main_join(api, joinCode);
                     current_state = STATE_MULTIPLAYER_ONLINE;
-                    game_restart();
+                    game_restart(&world);
+                    reset_online_sync();
                 } else {
                     current_state = STATE_MENU;
                 }
@@ -271,115 +445,101 @@ int main() {
                 }
                 if (active_players >= 2) {
                     current_state = STATE_MULTIPLAYER_ONLINE;
-                    game_restart();
+                    game_restart(&world);
+                    reset_online_sync();
                 }
-                usleep(100000); 
             break;
 
             case STATE_MULTIPLAYER_ONLINE: 
                 last_active_mode = STATE_MULTIPLAYER_ONLINE;
 
-                pollSinglePlayerInput(); 
-                moveSnake(); 
+                WorldInput in;
+                pollSinglePlayerInput(&world, &in); 
 
-                if (checkCollision()) {
+                // The host also eats and respawns food inside world_step
+                if (world_step(&world, &in)) {
                     current_state = STATE_GAME_OVER;
                 }
             
-                if (is_host) {
-                    if (snake[0].x == foodX && snake[0].y == foodY) {
-                        snake_length++;
-                        spawnFood(); 
-                    }
-                }
-            
                 // --- PACKING DATA ---
-                json_t *syncData = json_object();
-                json_t *body = json_array();
-                for (int i = 0; i < snake_length; i++) {
-                    json_t *seg = json_object();
-                    json_object_set_new(seg, "x", json_integer(snake[i].x));
-                    json_object_set_new(seg, "y", json_integer(snake[i].y));
-                    json_array_append_new(body, seg);
-                }
-                json_object_set_new(syncData, "body", body);
-            
-                if (is_host) {
-                    json_object_set_new(syncData, "fx", json_integer(foodX));
-                    json_object_set_new(syncData, "fy", json_integer(foodY));
+                // Written straight into a buffer: no JSON tree, no malloc per tick
+                static char syncText[SYNC_TEXT_MAX];
+                Segment food = { world.foodX[0], world.foodY[0] };
+                int syncLen = sync_write(&sync_out, &world.players[0].body,
+                                         is_host ? &food : NULL, syncText, sizeof(syncText));
+                if (syncLen > 0) {
+                    // Only keyframes may replace each other in a full send
+                    // queue; a delta that was turned away means the next
+                    // message has to be a keyframe
+                    int sent = sync_out.wrote_keyframe
+                        ? mp_api_game_state_text(api, syncText, (size_t)syncLen)
+                        : mp_api_game_text(api, syncText, (size_t)syncLen);
+                    if (sent != MP_API_OK) {
+                        sync_request_keyframe(&sync_out);
+                    }
                 }
             
-                mp_api_game(api, syncData);
-                json_decref(syncData); 
-            
-                draw(); 
-                usleep(100000); 
+                draw(&world); 
             break;
 
 			case STATE_STARVATION_ROYALE: 
 			    static time_t lobby_start = 0;
 			    static int game_started = 0;
-			    static int initial_players = 0;
+			    static int lobby_shown = -1;
 
 			    if (!game_started) {
 			        if (lobby_start == 0) lobby_start = time(NULL);
 			        int countdown = 60 - (int)(time(NULL) - lobby_start);
 				
-			        printf("\033[H\033[2J=== LOBBY ===\nPlayers: %d\nStarts in: %d\n", active_players, countdown);
+			        // The lobby ticks at game rate, so only redraw when the count changes
+			        if (countdown != lobby_shown) {
+			            printf("\033[H\033[2J=== LOBBY ===\nPlayers: %d\nStarts in: %d\n", active_players, countdown);
+			            fflush(stdout);
+			            lobby_shown = countdown;
+			        }
 				
 			        if (countdown <= 0) {
 			            game_started = 1;
-			            initial_players = active_players;
-			            game_restart();
-			            updateArenaSize(active_players); // 20x20 for 10 players, etc.
+			            startRoyale(&world, active_players);
 			        }
-			        usleep(500000);
 			    } else {
-			        pollSinglePlayerInput();
-			        moveSnake();
-				
-			        // SHRINK LOGIC: If half the players are gone, shrink map 1.5x
-			        if (active_players <= initial_players / 2) {
-			            currentWidth /= 1.5;
-			            currentHeight /= 1.5;
-			            // Ensure we don't shrink to 0
-			            if (currentWidth < 5) currentWidth = 5; 
-			            if (currentHeight < 5) currentHeight = 5;
-			        }
+			        WorldInput in;
+			        pollSinglePlayerInput(&world, &in);
+
+			        // Starvation, food and the arena shrink all happen in world_step
+			        world.active_players = active_players;
+			        int died = world_step(&world, &in);
 				
 			        // Pack data for others
-			        json_t *syncData = json_object();
-			        json_object_set_new(syncData, "w", json_integer(currentWidth));
-			        json_object_set_new(syncData, "h", json_integer(currentHeight));
-
-
-			        mp_api_game(api, syncData);
-			        json_decref(syncData);
+			        char arenaText[64];
+			        int arenaLen = snprintf(arenaText, sizeof(arenaText), "{\"w\":%d,\"h\":%d}",
+			                                world.width, world.height);
+			        mp_api_game_state_text(api, arenaText, (size_t)arenaLen);
 				
-			        if (checkCollision()) {
+			        if (died) {
 			            current_state = STATE_ROYALE_SPECTATOR; 
 			        }
 				
-			        draw(); 
-			        usleep(100000);
+			        draw(&world); 
 			    }
 			break;
 			
 			case STATE_ROYALE_SPECTATOR:
-			    draw();
+			    draw(&world);
 			    printf("\n[ SPECTATING ] - %d Players remaining.\n", active_players);
 			    printf("Press M for Menu\n");
 			    char c_spec;
-			    if (read(STDIN_FILENO, &c_spec, 1) == 1 && (c_spec == 'm' || c_spec == 'M')) {
+			    if (read_key(&c_spec) && (c_spec == 'm' || c_spec == 'M')) {
 			        current_state = STATE_MENU;
 			    }
-			    usleep(100000);
 			break;
 
             case STATE_GAME_OVER: 
                 static int has_saved = 0;
                 if (!has_saved) {
-                    check_and_save_highscore(last_active_mode, snake_length - 3);
+                    check_and_save_highscore(last_active_mode, 0, world_score(&world, 0));
+                    if (last_active_mode == STATE_MULTIPLAYER_LOCAL)
+                        check_and_save_highscore(last_active_mode, 1, world_score(&world, 1));
                     has_saved = 1;
                 }
 
@@ -388,20 +548,32 @@ int main() {
                 printf("==========================================\n");
                 printf("                GAME OVER!                \n");
                 printf("==========================================\n");
-                printf(" Mode: %s\n", get_highscore_filename(last_active_mode));
-                printf(" Score: %d\n", snake_length - 3);
+                printf(" Mode: %s\n", get_mode_name(last_active_mode));
+                printf(" Score: %d\n", world_score(&world, 0));
                 printf(" BEST SCORE: %d\n", best);
                 printf("==========================================\n");
+                drawLeaderboard(last_active_mode, 5);
+                printf("==========================================\n");
+                if (last_active_mode == STATE_MULTIPLAYER_LOCAL) {
+                    drawInputLatency();
+                    printf("==========================================\n");
+                }
+                if (last_active_mode == STATE_MULTIPLAYER_ONLINE ||
+                    last_active_mode == STATE_STARVATION_ROYALE) {
+                    drawNetworkStats(api);
+                    printf("==========================================\n");
+                }
                 printf(" [R] Try Again   [M] Menu   [Q] Quit      \n");
                 
                 char c_go = 0;
-                if (read(STDIN_FILENO, &c_go, 1) == 1) {
+                if (read_key(&c_go)) {
                     if (c_go == 'r' || c_go == 'm') {
                         has_saved = 0; 
                         printf("\033[2J");
                         if (c_go == 'r') {
-                            game_restart();
                             current_state = last_active_mode;
+                            game_restart(&world);
+                            reset_online_sync();
                         } else {
                             current_state = STATE_MENU;
                         }
@@ -409,7 +581,6 @@ int main() {
                         goto cleanup;
                     }
                 }
-                usleep(50000);
             break;
 
             default:
@@ -419,7 +590,8 @@ int main() {
     } // End of while
 
 	cleanup:
-	    json_decref(gameData);
+	    event_loop_destroy(loop);
+	    tick_scheduler_close_fd(&ticker);
 	    mp_api_unlisten(api, listener_id);
 	    mp_api_destroy(api);
 